@@ -0,0 +1,138 @@
+#include <Engine.hpp>
+#include <ComputeProgram.hpp>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+/*
+  Elements per second: ComputeProgram dispatch vs. its CPU reference (one thread and the job system)
+  ELEMENTS floats in an SSBO go through ITERATIONS steps of a damped oscillator,
+  the GPU result is read back and compared with the reference before timing.
+  Runs headless, without compute (GL < 4.3) only the CPU rows are printed.
+*/
+
+static const int ELEMENTS = 1 << 20;
+static const int ITERATIONS = 64;
+static const int RUNS = 20;
+
+// Same math as the compute shader
+static inline void step(float &position, float &velocity) {
+    for (int i = 0; i < ITERATIONS; i++) {
+        velocity = velocity * 0.99f - position * 0.01f;
+        position = position + velocity * 0.1f;
+    }
+}
+
+class ComputeBenchmark : public Engine {
+public:
+    ComputeBenchmark() {
+        title = "compute-benchmark";
+        headless = true;
+        headlessFrames = 1;
+        hotReload = false;
+    }
+
+    void startup() {
+        static const GLchar *source =
+            "#version 430 core\n"
+            "layout (local_size_x = 256) in;\n"
+            "layout (std430, binding = 0) buffer State { vec2 state[]; };\n"
+            "uniform uint count;\n"
+            "void main(void) {\n"
+            "    uint i = gl_GlobalInvocationID.x;\n"
+            "    if (i >= count) return;\n"
+            "    vec2 s = state[i];\n"
+            "    for (int k = 0; k < 64; k++) {\n"
+            "        s.y = s.y * 0.99 - s.x * 0.01;\n"
+            "        s.x = s.x + s.y * 0.1;\n"
+            "    }\n"
+            "    state[i] = s;\n"
+            "}\n";
+        compute.build(source, &shaderCache);
+
+        initial.resize(ELEMENTS * 2);
+        for (int i = 0; i < ELEMENTS; i++) {
+            initial[i * 2] = (float)(i % 1000) / 500.0f - 1.0f;
+            initial[i * 2 + 1] = 0.0f;
+        }
+    }
+
+    // State is (position, velocity) pairs
+    double cpu(bool parallel) {
+        std::vector<float> state(initial);
+        float *s = &state[0];
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int r = 0; r < RUNS; r++) {
+            if (parallel) {
+                ComputeProgram::reference(jobs, ELEMENTS, 1, 1, [&](GLuint x, GLuint, GLuint) {
+                    step(s[x * 2], s[x * 2 + 1]);
+                });
+            } else {
+                for (int i = 0; i < ELEMENTS; i++) step(s[i * 2], s[i * 2 + 1]);
+            }
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void render(double currentTime) {
+        printf("%d elements, %d iterations each, %d runs, %d job system threads\n", ELEMENTS, ITERATIONS, RUNS,
+               jobs.threadCount());
+        printf("path                          ms/run   Melements/s\n");
+        report("CPU reference, one thread", cpu(false));
+        report("CPU reference, job system", cpu(true));
+
+        if (!compute.valid()) {
+            printf("compute shader not available\n");
+            return;
+        }
+
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        ComputeProgram::bindStorage(0, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, initial.size() * sizeof(float), &initial[0], GL_DYNAMIC_COPY);
+        compute.use();
+        glUniform1ui(compute.uniform("count"), ELEMENTS);
+
+        // One run to validate: every element against the reference
+        compute.dispatchInvocations(ELEMENTS);
+        ComputeProgram::barrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        std::vector<float> gpu(initial.size());
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpu.size() * sizeof(float), &gpu[0]);
+        std::vector<float> expected(initial);
+        float *e = &expected[0];
+        ComputeProgram::reference(jobs, ELEMENTS, 1, 1, [&](GLuint x, GLuint, GLuint) {
+            step(e[x * 2], e[x * 2 + 1]);
+        });
+        float largest = 0.0f;
+        for (size_t i = 0; i < gpu.size(); i++) largest = fmaxf(largest, fabsf(gpu[i] - expected[i]));
+        printf("validation: largest difference %g (%s)\n", largest, largest < 1e-3f ? "ok" : "MISMATCH");
+
+        // Back-to-back dispatches on the same data need the storage barrier between them
+        glFinish();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int r = 0; r < RUNS; r++) {
+            compute.dispatchInvocations(ELEMENTS);
+            ComputeProgram::barrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        glFinish();
+        report("glDispatchCompute", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        glDeleteBuffers(1, &buffer);
+        GLState::bufferDeleted(buffer);
+    }
+
+    void shutdown() {
+        compute.destroy();
+    }
+
+private:
+    ComputeProgram compute;
+    std::vector<float> initial;
+
+    static void report(const char *name, double seconds) {
+        double perRun = seconds / RUNS;
+        printf("%-26s %10.3f %13.2f\n", name, perRun * 1000.0, ELEMENTS / perRun / 1e6);
+    }
+};
+
+DECLARE_MAIN(ComputeBenchmark);
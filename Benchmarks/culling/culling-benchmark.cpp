@@ -0,0 +1,96 @@
+#include <Culling.hpp>
+#include <JobSystem.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+  Culling cost per object
+  Spheres and boxes scattered around a camera, 10k / 100k / 1M objects,
+  single threaded and split over the job system. Results are checked against a plain loop.
+*/
+
+static const int REPEATS = 20;
+
+static float randomFloat(float low, float high) { return low + (high - low) * (float)rand() / RAND_MAX; }
+
+template <typename F>
+static double measure(F body) {
+    body();  // warm up
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; r++) body();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / REPEATS;
+}
+
+static int referenceSpheres(const Frustum &frustum, const SphereBounds &s, int count, std::vector<int> &visible) {
+    visible.clear();
+    for (int i = 0; i < count; i++) {
+        bool inside = true;
+        for (int p = 0; p < Frustum::PLANE_COUNT && inside; p++) {
+            const vmath::vec4 &plane = frustum.planes[p];
+            inside = plane[0] * s.x[i] + plane[1] * s.y[i] + plane[2] * s.z[i] + plane[3] >= -s.radius[i];
+        }
+        if (inside) visible.push_back(i);
+    }
+    return (int)visible.size();
+}
+
+static bool sameIndices(const int *a, const std::vector<int> &b, int count) {
+    if (count != (int)b.size()) return false;
+    for (int i = 0; i < count; i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+int main(int argc, const char **argv) {
+    JobSystem jobs;
+    jobs.start();
+
+    Culler culler;
+    vmath::mat4 projection = vmath::perspective(60.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    vmath::mat4 view = vmath::lookat(vmath::vec3(0.0f, 10.0f, 0.0f), vmath::vec3(100.0f, 0.0f, 50.0f),
+                                     vmath::vec3(0.0f, 1.0f, 0.0f));
+    culler.setViewProjection(projection * view);
+
+    printf("AVX path: %s, %d threads\n", Culler::simd() ? "yes" : "no", jobs.threadCount());
+    printf("objects    visible   spheres ns/obj   (jobs)   boxes ns/obj   (jobs)   check\n");
+
+    const int sizes[] = {10000, 100000, 1000000};
+    for (int s = 0; s < 3; s++) {
+        int count = sizes[s];
+        std::vector<float> x(count), y(count), z(count), radius(count), ex(count), ey(count), ez(count);
+        for (int i = 0; i < count; i++) {
+            x[i] = randomFloat(-500.0f, 500.0f);
+            y[i] = randomFloat(-20.0f, 40.0f);
+            z[i] = randomFloat(-500.0f, 500.0f);
+            radius[i] = randomFloat(0.5f, 5.0f);
+            ex[i] = randomFloat(0.5f, 4.0f);
+            ey[i] = randomFloat(0.5f, 4.0f);
+            ez[i] = randomFloat(0.5f, 4.0f);
+        }
+        SphereBounds spheres = {&x[0], &y[0], &z[0], &radius[0]};
+        BoxBounds boxes = {&x[0], &y[0], &z[0], &ex[0], &ey[0], &ez[0]};
+        std::vector<int> visible(count), reference;
+
+        int visibleSpheres = 0, visibleBoxes = 0;
+        double sphereTime = measure([&] { visibleSpheres = culler.cullSpheres(spheres, count, &visible[0]); });
+        bool correct = sameIndices(&visible[0], reference, referenceSpheres(culler.frustum, spheres, count, reference));
+        double sphereJobsTime = measure([&] { visibleSpheres = culler.cullSpheres(jobs, spheres, count, &visible[0]); });
+        correct &= sameIndices(&visible[0], reference, visibleSpheres);
+
+        double boxTime = measure([&] { visibleBoxes = culler.cullBoxes(boxes, count, &visible[0]); });
+        std::vector<int> single(visible.begin(), visible.begin() + visibleBoxes);
+        double boxJobsTime = measure([&] { visibleBoxes = culler.cullBoxes(jobs, boxes, count, &visible[0]); });
+        correct &= sameIndices(&visible[0], single, visibleBoxes);
+
+        double scale = 1e9 / count;
+        printf("%7d %10d %16.2f %8.2f %14.2f %8.2f   %s\n", count, visibleSpheres, sphereTime * scale,
+               sphereJobsTime * scale, boxTime * scale, boxJobsTime * scale, correct ? "ok" : "MISMATCH");
+    }
+
+    jobs.stop();
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <Engine.hpp>
+#include <IndirectBatch.hpp>
+#include <MeshArena.hpp>
+#include <chrono>
+
+/*
+  Draws per second: one call per object vs. IndirectBatch (fallback loop and multi-draw indirect)
+  OBJECTS small quads from a MeshArena, every object finds its grid cell through the draw id.
+  Runs headless, FRAMES_PER_MODE frames per mode, commands are built on the job system every frame.
+*/
+
+static const int OBJECTS = 20000;
+static const int MESHES = 16;
+static const int FRAMES_PER_MODE = 200;
+
+class IndirectDrawBenchmark : public Engine {
+public:
+    IndirectDrawBenchmark() {
+        title = "indirect-draw-benchmark";
+        headless = true;
+        headlessFrames = FRAMES_PER_MODE * 3;
+        hotReload = false;
+    }
+
+    void startup() {
+        static const GLchar *vertexSource =
+            "#version 330 core\n"
+            "layout (location = 0) in vec2 position;\n"
+            "layout (location = 1) in uint drawId;\n"
+            "uniform uint drawIdOffset;\n"
+            "flat out uint id;\n"
+            "void main(void) {\n"
+            "    id = drawId + drawIdOffset;\n"
+            "    vec2 cell = vec2(float(id % 200u), float(id / 200u)) / 100.0 - 1.0;\n"
+            "    gl_Position = vec4(cell + position, 0.0, 1.0);\n"
+            "}\n";
+        static const GLchar *fragmentSource =
+            "#version 330 core\n"
+            "flat in uint id;\n"
+            "out vec4 color;\n"
+            "void main(void) {\n"
+            "    color = vec4(float(id & 255u) / 255.0, 0.5, 0.2, 1.0);\n"
+            "}\n";
+        ShaderStage stages[] = {{GL_VERTEX_SHADER, vertexSource}, {GL_FRAGMENT_SHADER, fragmentSource}};
+        program.build(stages, 2, &shaderCache);
+        drawIdOffset = program.uniform("drawIdOffset");
+
+        // A few quad sizes so the draws really use different baseVertex / firstIndex
+        VertexAttribute position = {0, 2, GL_FLOAT, GL_FALSE, 0};
+        arena.create(&position, 1, 2 * sizeof(float), MESHES * 4, MESHES * 6);
+        for (int m = 0; m < MESHES; m++) {
+            float s = 0.002f + 0.0003f * m;
+            const float vertices[] = {0.0f, 0.0f, s, 0.0f, s, s, 0.0f, s};
+            const GLuint indices[] = {0, 1, 2, 0, 2, 3};
+            meshes[m] = arena.add(vertices, 4, indices, 6);
+        }
+
+        fallback.create(OBJECTS, false);
+        multiDraw.create(OBJECTS);
+        fallback.attach(arena.vertexArray(), 1);
+        multiDraw.attach(arena.vertexArray(), 1);
+
+        frameIndex = 0;
+        for (int m = 0; m < 3; m++) seconds[m] = 0.0;
+    }
+
+    void shutdown() {
+        glFinish();
+        const char *names[] = {"one draw per object", "IndirectBatch fallback loop", "glMultiDrawElementsIndirect"};
+        printf("%d objects, %d frames per mode, multi-draw indirect %s\n", OBJECTS, FRAMES_PER_MODE,
+               multiDraw.multiDrawIndirect() ? "available" : "NOT available (fallback timed twice)");
+        printf("mode                              ms/frame     Mdraws/s\n");
+        for (int m = 0; m < 3; m++) {
+            double perFrame = seconds[m] / FRAMES_PER_MODE;
+            printf("%-30s %11.3f %12.2f\n", names[m], perFrame * 1000.0, OBJECTS / perFrame / 1e6);
+        }
+        fallback.destroy();
+        multiDraw.destroy();
+        arena.destroy();
+        program.destroy();
+    }
+
+    void render(double currentTime) {
+        int mode = frameIndex / FRAMES_PER_MODE;
+        if (mode > 2) return;
+        // Each mode starts with an idle GPU
+        if (frameIndex % FRAMES_PER_MODE == 0) glFinish();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const GLfloat black[] = {0.0f, 0.0f, 0.0f, 1.0f};
+        glClearBufferfv(GL_COLOR, 0, black);
+        program.use();
+        arena.bind();
+
+        if (mode == 0) {
+            for (int i = 0; i < OBJECTS; i++) {
+                glUniform1ui(drawIdOffset, (GLuint)i);
+                arena.draw(meshes[i % MESHES]);
+            }
+        } else {
+            IndirectBatch &batch = mode == 1 ? fallback : multiDraw;
+            glUniform1ui(drawIdOffset, 0);
+            DrawElementsIndirectCommand *commands = batch.begin(OBJECTS);
+            if (commands) {
+                jobs.parallelFor(0, OBJECTS, 1024, [&](int begin, int end) {
+                    for (int i = begin; i < end; i++) {
+                        const MeshRange &r = arena.range(meshes[i % MESHES]);
+                        IndirectBatch::command(commands[i], (GLuint)i, r.indexCount, r.firstIndex, r.baseVertex);
+                    }
+                });
+            }
+            batch.submit(GL_TRIANGLES);
+        }
+
+        // The last frame of a mode includes waiting for the GPU to finish it all
+        if (frameIndex % FRAMES_PER_MODE == FRAMES_PER_MODE - 1) glFinish();
+        seconds[mode] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        frameIndex++;
+    }
+
+private:
+    ShaderProgram program;
+    GLint drawIdOffset;
+    MeshArena arena;
+    unsigned meshes[MESHES];
+    IndirectBatch fallback;
+    IndirectBatch multiDraw;
+    int frameIndex;
+    double seconds[3];
+};
+
+DECLARE_MAIN(IndirectDrawBenchmark);
@@ -0,0 +1,137 @@
+#include <Engine.hpp>
+#include <InstanceBuffer.hpp>
+#include <chrono>
+
+/*
+  Objects per second: one draw per object vs. one instanced draw through InstanceBuffer
+  OBJECTS small moving triangles, the per-object path sets offset and color with glVertexAttrib4fv,
+  the instanced path writes the same data into the instance stream on the job system.
+  Runs headless, FRAMES_PER_MODE frames per mode.
+*/
+
+static const int OBJECTS = 100000;
+static const int FRAMES_PER_MODE = 100;
+
+class InstancingBenchmark : public Engine {
+public:
+    InstancingBenchmark() {
+        title = "instancing-benchmark";
+        headless = true;
+        headlessFrames = FRAMES_PER_MODE * 2;
+        hotReload = false;
+    }
+
+    void startup() {
+        static const GLchar *vertexSource =
+            "#version 330 core\n"
+            "layout (location = 0) in vec4 offset;\n"
+            "layout (location = 1) in vec4 color;\n"
+            "out vec4 vs_color;\n"
+            "void main(void) {\n"
+            "    const vec2 vertices[3] = vec2[3](vec2(0.004, -0.004), vec2(-0.004, -0.004), vec2(0.004, 0.004));\n"
+            "    gl_Position = vec4(vertices[gl_VertexID], 0.5, 1.0) + offset;\n"
+            "    vs_color = color;\n"
+            "}\n";
+        static const GLchar *fragmentSource =
+            "#version 330 core\n"
+            "in vec4 vs_color;\n"
+            "out vec4 color;\n"
+            "void main(void) {\n"
+            "    color = vs_color;\n"
+            "}\n";
+        ShaderStage stages[] = {{GL_VERTEX_SHADER, vertexSource}, {GL_FRAGMENT_SHADER, fragmentSource}};
+        program.build(stages, 2, &shaderCache);
+
+        // Per-object path: attributes 0 and 1 stay disabled, glVertexAttrib4fv feeds them
+        glGenVertexArrays(1, &perObjectVao);
+
+        glGenVertexArrays(1, &instancedVao);
+        const VertexAttribute perInstance[] = {
+            {0, 4, GL_FLOAT, GL_FALSE, 0},
+            {1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat)}
+        };
+        instances.create(perInstance, 2, 8 * sizeof(GLfloat), OBJECTS);
+        instances.attach(instancedVao);
+
+        frameIndex = 0;
+        for (int m = 0; m < 2; m++) seconds[m] = 0.0;
+    }
+
+    void shutdown() {
+        glFinish();
+        const char *names[] = {"one draw per object", "InstanceBuffer"};
+        printf("%d objects, %d frames per mode\n", OBJECTS, FRAMES_PER_MODE);
+        printf("mode                       ms/frame   Mobjects/s\n");
+        for (int m = 0; m < 2; m++) {
+            double perFrame = seconds[m] / FRAMES_PER_MODE;
+            printf("%-22s %12.3f %12.2f\n", names[m], perFrame * 1000.0, OBJECTS / perFrame / 1e6);
+        }
+        instances.destroy();
+        glDeleteVertexArrays(1, &instancedVao);
+        glDeleteVertexArrays(1, &perObjectVao);
+        GLState::vertexArrayDeleted(instancedVao);
+        GLState::vertexArrayDeleted(perObjectVao);
+        program.destroy();
+    }
+
+    // Same motion for both paths: a grid of triangles drifting on circles
+    static void object(int i, double t, GLfloat *a) {
+        float x = (float)(i % 316) / 158.0f - 1.0f;
+        float y = (float)(i / 316) / 158.0f - 1.0f;
+        a[0] = x + (float)sin(t + i) * 0.01f;
+        a[1] = y + (float)cos(t + i) * 0.01f;
+        a[2] = 0.0f;
+        a[3] = 0.0f;
+        a[4] = (float)(i & 255) / 255.0f;
+        a[5] = 0.5f;
+        a[6] = 0.2f;
+        a[7] = 1.0f;
+    }
+
+    void render(double currentTime) {
+        int mode = frameIndex / FRAMES_PER_MODE;
+        if (mode > 1) return;
+        // Each mode starts with an idle GPU
+        if (frameIndex % FRAMES_PER_MODE == 0) glFinish();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const GLfloat black[] = {0.0f, 0.0f, 0.0f, 1.0f};
+        glClearBufferfv(GL_COLOR, 0, black);
+        program.use();
+
+        if (mode == 0) {
+            GLState::bindVertexArray(perObjectVao);
+            GLfloat a[8];
+            for (int i = 0; i < OBJECTS; i++) {
+                object(i, currentTime, a);
+                glVertexAttrib4fv(0, a);
+                glVertexAttrib4fv(1, a + 4);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+        } else {
+            GLfloat *attrib = (GLfloat *)instances.begin(OBJECTS);
+            if (attrib) {
+                jobs.parallelFor(0, OBJECTS, 4096, [&](int begin, int end) {
+                    for (int i = begin; i < end; i++) object(i, currentTime, attrib + i * 8);
+                });
+                instances.drawArrays(GL_TRIANGLES, 0, 3);
+            }
+            instances.end();
+        }
+
+        // The last frame of a mode includes waiting for the GPU to finish it all
+        if (frameIndex % FRAMES_PER_MODE == FRAMES_PER_MODE - 1) glFinish();
+        seconds[mode] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        frameIndex++;
+    }
+
+private:
+    ShaderProgram program;
+    GLuint perObjectVao;
+    GLuint instancedVao;
+    InstanceBuffer instances;
+    int frameIndex;
+    double seconds[2];
+};
+
+DECLARE_MAIN(InstancingBenchmark);
@@ -0,0 +1,53 @@
+#include <JobSystem.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/*
+  Job system scaling
+  Runs the same parallelFor workload with 1..N threads and prints the speedup over 1 thread.
+  Workload is a bit of math per element, roughly what culling/animation jobs do.
+*/
+
+static const int ELEMENTS = 1 << 22;
+static const int GRAIN = 4096;
+static const int REPEATS = 10;
+
+static double runWorkload(JobSystem &jobs, std::vector<float> &data) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; r++) {
+        jobs.parallelFor(0, ELEMENTS, GRAIN, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                float x = data[i];
+                data[i] = sqrtf(x * x + 1.0f) * 0.5f + sinf(x) * 0.25f;
+            }
+        });
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, const char **argv) {
+    int hardwareThreads = (int)std::thread::hardware_concurrency();
+    if (hardwareThreads < 1) hardwareThreads = 1;
+
+    std::vector<float> data(ELEMENTS);
+    for (int i = 0; i < ELEMENTS; i++) data[i] = (float)i / ELEMENTS;
+
+    printf("%d elements, grain %d, %d repeats\n", ELEMENTS, GRAIN, REPEATS);
+    printf("threads      time (ms)    Melem/s    speedup\n");
+
+    double baseline = 0.0;
+    for (int threads = 1; threads <= hardwareThreads; threads++) {
+        JobSystem jobs;
+        jobs.start(threads - 1);
+        runWorkload(jobs, data);  // warm up
+        double seconds = runWorkload(jobs, data);
+        jobs.stop();
+
+        if (threads == 1) baseline = seconds;
+        printf("%7d %14.2f %10.1f %9.2fx\n", threads, seconds * 1000.0,
+               (double)ELEMENTS * REPEATS / seconds / 1e6, baseline / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <TransformBatch.hpp>
+#include <linmath.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+  Batched transforms vs one linmath call per object
+  50k objects: view-projection * model for every object, and 1M SoA positions through one matrix.
+  Every TransformBatch path this CPU supports is timed and checked against linmath.
+*/
+
+static const int OBJECTS = 50000;
+static const int POINTS = 1 << 20;
+static const int REPEATS = 20;
+
+static float randomFloat() { return (float)rand() / RAND_MAX * 2.0f - 1.0f; }
+
+template <typename F>
+static double measure(F body) {
+    body();  // warm up
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; r++) body();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / REPEATS;
+}
+
+int main(int argc, const char **argv) {
+    mat4x4 linViewProjection;
+    vmath::mat4 viewProjection;
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) linViewProjection[c][r] = viewProjection[c][r] = randomFloat();
+    }
+
+    std::vector<mat4x4> linModels(OBJECTS), linOut(OBJECTS);
+    std::vector<vmath::mat4> models(OBJECTS), out(OBJECTS);
+    for (int i = 0; i < OBJECTS; i++) {
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) linModels[i][c][r] = models[i][c][r] = randomFloat();
+        }
+    }
+
+    std::vector<float> x(POINTS), y(POINTS), z(POINTS);
+    std::vector<float> outX(POINTS), outY(POINTS), outZ(POINTS), outW(POINTS);
+    std::vector<vec4> linPoints(POINTS), linPointsOut(POINTS);
+    for (int i = 0; i < POINTS; i++) {
+        linPoints[i][0] = x[i] = randomFloat();
+        linPoints[i][1] = y[i] = randomFloat();
+        linPoints[i][2] = z[i] = randomFloat();
+        linPoints[i][3] = 1.0f;
+    }
+
+    double linMultiply = measure([&] {
+        for (int i = 0; i < OBJECTS; i++) mat4x4_mul(linOut[i], linViewProjection, linModels[i]);
+    });
+    double linTransform = measure([&] {
+        for (int i = 0; i < POINTS; i++) mat4x4_mul_vec4(linPointsOut[i], linViewProjection, linPoints[i]);
+    });
+
+    printf("%d matrices, %d points, best path: %s\n", OBJECTS, POINTS, TransformBatch::name(TransformBatch::best()));
+    printf("path        matrices (ms) speedup   points (ms) speedup   max error\n");
+    printf("%-10s %13.3f %7.2fx %13.3f %7.2fx\n", "linmath", linMultiply * 1000.0, 1.0, linTransform * 1000.0, 1.0);
+
+    for (int p = TransformBatch::SCALAR; p <= TransformBatch::best(); p++) {
+        TransformBatch::setPath((TransformBatch::Path)p);
+        double multiply = measure([&] {
+            TransformBatch::multiply(viewProjection, &models[0], &out[0], OBJECTS);
+        });
+        double transform = measure([&] {
+            TransformBatch::transformPoints(viewProjection, &x[0], &y[0], &z[0],
+                                            &outX[0], &outY[0], &outZ[0], &outW[0], POINTS);
+        });
+
+        // FMA rounds differently, compare with a tolerance
+        float worst = 0.0f;
+        for (int i = 0; i < OBJECTS; i++) {
+            for (int c = 0; c < 4; c++) {
+                for (int r = 0; r < 4; r++) worst = fmaxf(worst, fabsf(out[i][c][r] - linOut[i][c][r]));
+            }
+        }
+        for (int i = 0; i < POINTS; i++) {
+            worst = fmaxf(worst, fabsf(outX[i] - linPointsOut[i][0]));
+            worst = fmaxf(worst, fabsf(outY[i] - linPointsOut[i][1]));
+            worst = fmaxf(worst, fabsf(outZ[i] - linPointsOut[i][2]));
+            worst = fmaxf(worst, fabsf(outW[i] - linPointsOut[i][3]));
+        }
+
+        printf("%-10s %13.3f %7.2fx %13.3f %7.2fx %11g\n", TransformBatch::name((TransformBatch::Path)p),
+               multiply * 1000.0, linMultiply / multiply, transform * 1000.0, linTransform / transform, worst);
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <VectorMath.hpp>
+#include <linmath.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+  vmath vs linmath.h
+  Same random matrices through both libraries: mat4 * mat4, mat4 * vec4 and inverse.
+  No "using namespace vmath", linmath.h already owns the vec3/vec4 names.
+*/
+
+static const int COUNT = 4096;
+static const int REPEATS = 200;
+
+static float randomFloat() { return (float)rand() / RAND_MAX * 2.0f - 1.0f; }
+
+template <typename F>
+static double measure(F body) {
+    body();  // warm up
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; r++) body();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *name, double linmathSeconds, double vmathSeconds) {
+    double scale = 1e9 / ((double)COUNT * REPEATS);
+    printf("%-14s %12.2f %12.2f %9.2fx\n", name, linmathSeconds * scale, vmathSeconds * scale,
+           linmathSeconds / vmathSeconds);
+}
+
+int main(int argc, const char **argv) {
+    std::vector<mat4x4> linA(COUNT), linB(COUNT), linOut(COUNT);
+    std::vector<vec4> linV(COUNT), linVOut(COUNT);
+    std::vector<vmath::mat4> vmA(COUNT), vmB(COUNT), vmOut(COUNT);
+    std::vector<vmath::vec4> vmV(COUNT), vmVOut(COUNT);
+
+    for (int i = 0; i < COUNT; i++) {
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                float a = randomFloat(), b = randomFloat();
+                // keep the diagonal dominant so every matrix is invertible
+                if (c == r) a += 4.0f;
+                linA[i][c][r] = vmA[i][c][r] = a;
+                linB[i][c][r] = vmB[i][c][r] = b;
+            }
+            linV[i][c] = vmV[i][c] = randomFloat();
+        }
+    }
+
+#if defined(VMATH_AVX)
+    const char *path = "AVX";
+#elif defined(VMATH_SSE)
+    const char *path = "SSE";
+#else
+    const char *path = "scalar";
+#endif
+    printf("%d matrices, %d repeats, vmath path: %s\n", COUNT, REPEATS, path);
+    printf("operation      linmath ns   vmath ns     speedup\n");
+
+    double lin = measure([&] {
+        for (int i = 0; i < COUNT; i++) mat4x4_mul(linOut[i], linA[i], linB[i]);
+    });
+    double vm = measure([&] {
+        for (int i = 0; i < COUNT; i++) vmOut[i] = vmA[i] * vmB[i];
+    });
+    report("mat4 * mat4", lin, vm);
+
+    lin = measure([&] {
+        for (int i = 0; i < COUNT; i++) mat4x4_mul_vec4(linVOut[i], linA[i], linV[i]);
+    });
+    vm = measure([&] {
+        for (int i = 0; i < COUNT; i++) vmVOut[i] = vmA[i] * vmV[i];
+    });
+    report("mat4 * vec4", lin, vm);
+
+    lin = measure([&] {
+        for (int i = 0; i < COUNT; i++) mat4x4_invert(linOut[i], linA[i]);
+    });
+    vm = measure([&] {
+        for (int i = 0; i < COUNT; i++) vmOut[i] = vmath::inverse(vmA[i]);
+    });
+    report("inverse", lin, vm);
+
+    // Results have to agree, otherwise the timings mean nothing
+    float worst = 0.0f;
+    for (int i = 0; i < COUNT; i++) {
+        mat4x4 check;
+        mat4x4_mul(check, linA[i], linB[i]);
+        vmath::mat4 product = vmA[i] * vmB[i];
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                float error = fabsf(check[c][r] - product[c][r]);
+                if (error > worst) worst = error;
+            }
+        }
+    }
+    printf("max |linmath - vmath| for mat4 * mat4: %g\n", worst);
+    return 0;
+}
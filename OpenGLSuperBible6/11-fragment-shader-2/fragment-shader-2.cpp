@@ -1,5 +1,4 @@
 #include <Engine.hpp>
-#include <Vector>
 
 /*
   Fragment shader is the last programmable stage in the pipeline
@@ -14,38 +13,10 @@
 
 class FragmentShader2 : public Engine {
 private:
-    GLuint renderingProgram;
+    ShaderProgram renderingProgram;
     GLuint vertexArrayObject;
 
 public:
-    // Check compilation for errors
-    bool isShaderCompiled(GLuint shader) {
-        GLint  isCompiled = 0;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
-        if(isCompiled == GL_FALSE) {
-            GLint maxLength = 0;
-            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
-
-            // The maxLength includes the "NULL" character
-            std::vector<GLchar> errorLog(maxLength);
-            glGetShaderInfoLog(shader, maxLength, &maxLength, &errorLog[0]);
-
-            // Provide the ingolog in whatever manor you deem best
-            // Exit with failure
-            glDeleteShader(shader);
-
-            for(int i = 0; i<errorLog.size(); i++) {
-                std::cout << errorLog[i];
-            } std::cout << std::endl;
-
-            return false;
-        } else {
-            // Shader compilation is successful
-            return true;
-        }
-    }
-
-
     void startup() {
       // Source code for vertex shader
       static const GLchar * vertexShaderSource[] =
@@ -78,39 +49,25 @@ public:
         "}                                             \n"
       };
 
-      // Create and compile vertex shader
-      GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-      glShaderSource(vertexShader, 1, vertexShaderSource, 0);
-      glCompileShader(vertexShader);
-      isShaderCompiled(vertexShader);
-
-      // Create and compile fragment shader
-      GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-      glShaderSource(fragmentShader, 1, fragmentShaderSource, 0);
-      glCompileShader(fragmentShader);
-      isShaderCompiled(fragmentShader);
-
-      // Create program, attach shaders to it, link it
-      renderingProgram = glCreateProgram();
-      glAttachShader(renderingProgram, vertexShader);
-      glAttachShader(renderingProgram, fragmentShader);
-      glLinkProgram(renderingProgram);
-
-      // Delete the shaders as the program has them now
-      glDeleteShader(vertexShader);
-      glDeleteShader(fragmentShader);
+      // Compile every stage and link them, logs are printed when something fails
+      const ShaderStage stages[] =
+      {
+        { GL_VERTEX_SHADER, vertexShaderSource[0] },
+        { GL_FRAGMENT_SHADER, fragmentShaderSource[0] }
+      };
+      renderingProgram.build(stages, 2, &shaderCache);
 
       // Create a VAO
       glGenVertexArrays(1, &vertexArrayObject);
-      glBindVertexArray(vertexArrayObject);
+      GLState::bindVertexArray(vertexArrayObject);
     }
 
     // Override Virtual Shutdown Function
     void shutdown() {
       // Delete program object
+      renderingProgram.destroy();
       glDeleteVertexArrays(1, &vertexArrayObject);
-      glDeleteProgram(renderingProgram);
-      glDeleteVertexArrays(1, &vertexArrayObject);
+      GLState::vertexArrayDeleted(vertexArrayObject);
     }
 
     // Override Virtual Render Function
@@ -119,7 +76,7 @@ public:
         glClearBufferfv(GL_COLOR, 0, green);
 
         // Use the program we created earlier for rendering
-        glUseProgram(renderingProgram);
+        renderingProgram.use();
 
         // Needed for anything to draw with the tesselation on
         glDrawArrays(GL_TRIANGLES, 0, 3);
@@ -1,95 +1,190 @@
 #include <Engine.hpp>
-#include <Vector>
+#include <ComputeProgram.hpp>
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
 
 /*
   Compute shader available from OpenGL Version 4.3
-  (Not available on my macbook and so not able to debug this code)
+  A compute program is not part of the graphics pipeline, it can't be used to draw.
+  It's started with glDispatchCompute and writes its results to buffers (SSBO) or images,
+  the graphics pipeline reads those after a glMemoryBarrier.
+
+  Here the compute shader fills an image every frame, a full screen triangle shows it.
+  Without compute (my macbook) the same kernel runs on the CPU and the image is uploaded instead.
+  --reference forces the CPU path, --validate compares both paths once and prints the difference.
 */
 
+static const int IMAGE_SIZE = 512;
+
+// Same math as the compute shader below
+static void plasma(GLuint x, GLuint y, float time, unsigned char *pixel) {
+    float u = (float)x / IMAGE_SIZE;
+    float v = (float)y / IMAGE_SIZE;
+    float value = sinf(u * 10.0f + time) + sinf(v * 10.0f + time * 0.5f) + sinf((u + v) * 10.0f + time * 0.7f);
+    pixel[0] = (unsigned char)((0.5f + 0.5f * sinf(value)) * 255.0f + 0.5f);
+    pixel[1] = (unsigned char)((0.5f + 0.5f * sinf(value + 2.094f)) * 255.0f + 0.5f);
+    pixel[2] = (unsigned char)((0.5f + 0.5f * sinf(value + 4.188f)) * 255.0f + 0.5f);
+    pixel[3] = 255;
+}
+
 class ComputeShader : public Engine {
 private:
-    GLuint renderingProgram;
+    ComputeProgram computeProgram;
+    ShaderProgram renderingProgram;
     GLuint vertexArrayObject;
+    GLuint texture;
+    GLint timeLocation;
+    std::vector<unsigned char> pixels;  // CPU path
+    bool forceReference;
+    bool validate;
 
 public:
-    // Check compilation for errors
-    bool isShaderCompiled(GLuint shader) {
-        GLint  isCompiled = 0;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
-        if(isCompiled == GL_FALSE) {
-            GLint maxLength = 0;
-            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
-
-            // The maxLength includes the "NULL" character
-            std::vector<GLchar> errorLog(maxLength);
-            glGetShaderInfoLog(shader, maxLength, &maxLength, &errorLog[0]);
-
-            // Provide the ingolog in whatever manor you deem best
-            // Exit with failure
-            glDeleteShader(shader);
-
-            for(int i = 0; i<errorLog.size(); i++) {
-                std::cout << errorLog[i];
-            } std::cout << std::endl;
-
-            return false;
-        } else {
-            // Shader compilation is successful
-            return true;
-        }
+    ComputeShader() : forceReference(false), validate(false) {}
+
+    void parseArguments(int argc, const char **argv) {
+      std::vector<const char *> rest(1, argv[0]);
+      for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--reference") forceReference = true;
+        else if (arg == "--validate") validate = true;
+        else rest.push_back(argv[i]);
+      }
+      Engine::parseArguments((int)rest.size(), rest.data());
     }
 
-
     void startup() {
 
       // Source code for compute shader
-      static const GLchar * computeShaderSource[] =
+      static const GLchar * computeShaderSource =
+        "#version 430 core                                                                      \n"
+        // Tells OpenGL that the size of the local workgroup is going to be 16 x 16
+        "layout (local_size_x = 16, local_size_y = 16) in;                                      \n"
+        "layout (rgba8, binding = 0) uniform writeonly image2D target;                          \n"
+        "uniform float time;                                                                    \n"
+        "                                                                                       \n"
+        "void main(void) {                                                                      \n"
+        "   ivec2 p = ivec2(gl_GlobalInvocationID.xy);                                          \n"
+        "   ivec2 size = imageSize(target);                                                     \n"
+        "   // Work groups are rounded up, the last ones hang over the edge                     \n"
+        "   if (p.x >= size.x || p.y >= size.y) return;                                         \n"
+        "   vec2 uv = vec2(p) / vec2(size);                                                     \n"
+        "   float value = sin(uv.x * 10.0 + time) + sin(uv.y * 10.0 + time * 0.5)               \n"
+        "               + sin((uv.x + uv.y) * 10.0 + time * 0.7);                               \n"
+        "   imageStore(target, p, vec4(0.5 + 0.5 * sin(value), 0.5 + 0.5 * sin(value + 2.094),  \n"
+        "                              0.5 + 0.5 * sin(value + 4.188), 1.0));                   \n"
+        "}                                                                                      \n";
+
+      static const GLchar * vertexShaderSource =
+        "#version 330 core                                                                      \n"
+        "out vec2 uv;                                                                           \n"
+        "                                                                                       \n"
+        "void main(void) {                                                                      \n"
+        "   // One triangle covering the screen, no vertex buffer needed                        \n"
+        "   vec2 position = vec2(float((gl_VertexID & 1) * 4 - 1), float((gl_VertexID & 2) * 2 - 1));\n"
+        "   uv = position * 0.5 + 0.5;                                                          \n"
+        "   gl_Position = vec4(position, 0.5, 1.0);                                             \n"
+        "}                                                                                      \n";
+
+      static const GLchar * fragmentShaderSource =
+        "#version 330 core                                                                      \n"
+        "uniform sampler2D image;                                                               \n"
+        "in vec2 uv;                                                                            \n"
+        "out vec4 color;                                                                        \n"
+        "                                                                                       \n"
+        "void main(void) {                                                                      \n"
+        "   color = texture(image, uv);                                                         \n"
+        "}                                                                                      \n";
+
+      // Compile every stage and link them, logs are printed when something fails
+      const ShaderStage stages[] =
       {
-        "#version 430 core                                  \n"
-        // Tells OpenGL that the size of the local workgroup is going to be 32 x 32
-        "layout (local_size_x = 32, local_size_y = 32) in;  \n"
-        "                                                   \n"
-        "void main(void) {                                  \n"
-        "   // DO NOTHING                                   \n"
-        "}                                                  \n"
+        { GL_VERTEX_SHADER, vertexShaderSource },
+        { GL_FRAGMENT_SHADER, fragmentShaderSource }
       };
+      renderingProgram.build(stages, 2, &shaderCache);
 
-      // Create and compile fragment shader
-      GLuint computeShader = glCreate(GL_COMPUTE_SHADER);
-      glShaderSource(computeShader, 1, computeShaderSource, 0);
-      glCompileShader(computeShader);
-      isShaderCompiled(computeShader);
+      if (!forceReference || validate) computeProgram.build(computeShaderSource, &shaderCache);
+      timeLocation = computeProgram.uniform("time");
+      printf("Compute shader %s\n", computeProgram.valid() ? "available" : "not available, using the CPU reference");
 
-      // Create program, attach shaders to it, link it
-      renderingProgram = glCreateProgram();
-      glAttachShader(renderingProgram, computeShader);
-      glLinkProgram(renderingProgram);
-
-      // Delete the shaders as the program has them now
-      glDeleteShader(computeShader);
+      // The image both paths write, a single complete level so it can be bound as an image
+      glGenTextures(1, &texture);
+      GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMAGE_SIZE, IMAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+      pixels.resize(IMAGE_SIZE * IMAGE_SIZE * 4);
 
       // Create a VAO
       glGenVertexArrays(1, &vertexArrayObject);
-      glBindVertexArray(vertexArrayObject);
+
+      if (validate) compare();
+      if (forceReference) computeProgram.destroy();
+    }
+
+    // Runs the kernel on both paths and reports the largest difference per channel
+    void compare() {
+      if (!computeProgram.valid()) {
+        printf("Validation skipped, no compute shader\n");
+        return;
+      }
+      generate(1.0f, true);
+      std::vector<unsigned char> gpu(pixels.size());
+      GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+      glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &gpu[0]);
+      generate(1.0f, false);
+
+      int largest = 0;
+      for (size_t i = 0; i < gpu.size(); i++) {
+        int difference = abs((int)gpu[i] - (int)pixels[i]);
+        if (difference > largest) largest = difference;
+      }
+      printf("Validation: largest difference %d / 255 (%s)\n", largest, largest <= 2 ? "ok" : "MISMATCH");
+    }
+
+    void generate(float time, bool gpu) {
+      if (gpu) {
+        computeProgram.use();
+        glUniform1f(timeLocation, time);
+        ComputeProgram::bindImage(0, texture, GL_WRITE_ONLY, GL_RGBA8);
+        computeProgram.dispatchInvocations(IMAGE_SIZE, IMAGE_SIZE);
+        // Next reader samples the image (or reads it back with glGetTexImage)
+        ComputeProgram::barrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        return;
+      }
+
+      unsigned char *out = &pixels[0];
+      ComputeProgram::reference(jobs, IMAGE_SIZE, IMAGE_SIZE, 1, [&](GLuint x, GLuint y, GLuint) {
+        plasma(x, y, time, out + (y * IMAGE_SIZE + x) * 4);
+      });
+      GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, IMAGE_SIZE, IMAGE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, out);
     }
 
     // Override Virtual Shutdown Function
     void shutdown() {
-      // Delete program object
-      glDeleteVertexArrays(1, &vertexArrayObject);
-      glDeleteProgram(renderingProgram);
+      glDeleteTextures(1, &texture);
+      GLState::textureDeleted(texture);
       glDeleteVertexArrays(1, &vertexArrayObject);
+      GLState::vertexArrayDeleted(vertexArrayObject);
+      computeProgram.destroy();
+      renderingProgram.destroy();
     }
 
     // Override Virtual Render Function
     void render(double currentTime) {
+        generate((float)currentTime, computeProgram.valid());
+
         static const GLfloat green[] = { 0.0f, 0.25f, 0.0f,  1.0f };
         glClearBufferfv(GL_COLOR, 0, green);
 
-        // Use the program we created earlier for rendering
-        glUseProgram(renderingProgram);
-
-        // Needed for anything to draw with the tesselation on
+        // Draw with the rendering program, the compute program only produced the image
+        renderingProgram.use();
+        GLState::bindTexture(0, GL_TEXTURE_2D, texture);
+        GLState::bindVertexArray(vertexArrayObject);
         glDrawArrays(GL_TRIANGLES, 0, 3);
     }
 };
@@ -1,19 +1,74 @@
 #include <Engine.hpp>
+#include <TripleBuffer.hpp>
 #include <OpenGL/gl3.h>
+#include <string>
+
+/*
+  The animation runs on the fixed timestep loop: update() advances the clock of the animation
+  30 times a second, render() blends between the last two steps with alpha.
+  --threaded moves update() to the simulation thread, each step is handed to render() through a
+  TripleBuffer and render() clears with whichever step arrived last.
+*/
 
 class ColorAnimation : public Engine {
+private:
+    // One simulation step, the time before and after it
+    struct Step {
+        double previousTime;
+        double time;
+    };
+    Step step;                  // written by update() only
+    TripleBuffer<Step> steps;   // threaded: update() -> render()
+    Step latest;                // threaded: last step render() acquired
 
-public:
-    // Override Virtual Render Function
-    void render(double currentTime) {
-        // Multiply color values with currenTime for a simple animation
-        const GLfloat red[] = { (float)sin(currentTime) * 0.5f + 0.5f,
-                                (float)cos(currentTime) * 0.5f + 0.5f,
+    static void clear(double time) {
+        // Multiply color values with time for a simple animation
+        const GLfloat red[] = { (float)sin(time) * 0.5f + 0.5f,
+                                (float)cos(time) * 0.5f + 0.5f,
                                 0.0f, 1.0f };
 
         glClearBufferfv(GL_COLOR, 0, red);
     }
 
+public:
+    ColorAnimation() {
+        fixedTimestep = true;
+        updateInterval = 1.0 / 30.0;
+        step.previousTime = 0.0;
+        step.time = 0.0;
+        latest = step;
+    }
+
+    // --threaded runs update() on the simulation thread, the rest goes to the engine (--headless, ...)
+    void parseArguments(int argc, const char **argv) {
+        std::vector<const char *> rest(1, argv[0]);
+        for (int i = 1; i < argc; i++) {
+            if (std::string(argv[i]) == "--threaded") threadedUpdate = true;
+            else rest.push_back(argv[i]);
+        }
+        Engine::parseArguments((int)rest.size(), rest.data());
+    }
+
+    void update(double dt) {
+        step.previousTime = step.time;
+        step.time += dt;
+        if (threadedUpdate) {
+            steps.write() = step;
+            steps.publish();
+        }
+    }
+
+    // Fixed timestep, update() ran on this thread right before
+    void render(double currentTime, double alpha) {
+        clear(step.previousTime + (step.time - step.previousTime) * alpha);
+    }
+
+    // Threaded, steps don't line up with frames so there's nothing to blend against
+    void render(double currentTime) {
+        if (steps.acquire()) latest = steps.read();
+        clear(latest.time);
+    }
+
 };
 
 DECLARE_MAIN(ColorAnimation);
@@ -1,4 +1,3 @@
-// NOTE Seperate shader files not in use ATM
 // Shader compiler version
 // core indicates that we only use features from OpenGL core profile
 #version 330 core
@@ -1,5 +1,9 @@
 #include <Engine.hpp>
 
+#ifndef SHADER_DIR
+#define SHADER_DIR ""
+#endif
+
 /*
   OpenGL works by connecting a number of mini-programs called shaders together with fixed-function-glue.
   GFX Processor executes your shaders when you draw -> pipes in&outputs along the pipeline
@@ -25,55 +29,22 @@
 
 class HelloShadersDot : public Engine {
 private:
-    GLuint renderingProgram;
+    ShaderProgram renderingProgram;
     GLuint vertexArrayObject;
 
 public:
     // Override Virtual Startup Function
     void startup() {
-      // Source code for vertex shader
+      // Vertex and fragment shader live next to this file (SHADER_DIR is set by CMake)
       // NOTE had an issue with version 430 core
       // changing it to 330 solved the issue of OpenGL not drawing my point
-      static const GLchar * vertexShaderSource[] =
+      // Saving either file while the app runs rebuilds the program on the fly
+      const ShaderFile files[] =
       {
-        "#version 330 core                            \n"
-        "void main(void) {                            \n"
-        "   gl_Position = vec4(0.0, 0.0, 0.5, 1.0);   \n"
-        "}                                            \n"
+        { GL_VERTEX_SHADER, SHADER_DIR "vertex.shader" },
+        { GL_FRAGMENT_SHADER, SHADER_DIR "fragment.shader" }
       };
-
-      // Source code for fragment shader
-      static const GLchar * fragmentShaderSource[] =
-      {
-        "#version 330 core                            \n"
-        "                                             \n"
-        "out vec4 color;                              \n"
-        "                                             \n"
-        "void main(void) {                            \n"
-        "   color = vec4(0.0, 1.0, 1.0, 1.0);         \n"
-        "}                                            \n"
-      };
-
-      // Create and compile vertex shader
-      GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);             // Create empty shader object
-      glShaderSource(vertexShader, 1, vertexShaderSource, 0);           // Hands shader source code to shader object
-      glCompileShader(vertexShader);                                      // Compiles source code in shader object
-
-      // Create and compile fragment shader
-      GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-      glShaderSource(fragmentShader, 1, fragmentShaderSource, 0);
-      glCompileShader(fragmentShader);
-
-      // Create program, attach shaders to it, link it
-      renderingProgram = glCreateProgram();                                 // Creates program object
-      glAttachShader(renderingProgram, vertexShader);                      // Attach shader object to program object
-      glAttachShader(renderingProgram, fragmentShader);
-      glLinkProgram(renderingProgram);                                      // Links all shader objects attached to program together
-
-      // Delete the shaders as the program has them now
-      // shader objects not needed after linked into program object
-      glDeleteShader(vertexShader);
-      glDeleteShader(fragmentShader);
+      loadProgram(renderingProgram, files, 2);
 
       // NOTE This shows that the shader creation should be in a static function
       //rendering_program = compile_shaders();
@@ -84,15 +55,15 @@ public:
       // not used in this case as the vertex shader doesn't have any inputs atm
       // a VAO is still needed so OpenGL will let us draw
       glGenVertexArrays(1, &vertexArrayObject);
-      glBindVertexArray(vertexArrayObject);
+      GLState::bindVertexArray(vertexArrayObject);
     }
 
     // Override Virtual Shutdown Function
     void shutdown() {
       // shader cleanup
+      renderingProgram.destroy();
       glDeleteVertexArrays(1, &vertexArrayObject);
-      glDeleteProgram(renderingProgram);
-      glDeleteVertexArrays(1, &vertexArrayObject);
+      GLState::vertexArrayDeleted(vertexArrayObject);
     }
 
     // Override Virtual Render Function
@@ -101,7 +72,7 @@ public:
         glClearBufferfv(GL_COLOR, 0, green);
 
         // Use the program we created earlier for rendering
-        glUseProgram(renderingProgram);
+        renderingProgram.use();
 
         // Increase the point size
         glPointSize(40.0f);
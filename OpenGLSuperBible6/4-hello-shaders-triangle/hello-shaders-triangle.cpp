@@ -82,15 +82,16 @@ public:
       // not used in this case as the vertex shader doesn't have any inputs atm
       // a VAO is still needed so OpenGL will let us draw
       glGenVertexArrays(1, &vertexArrayObject);
-      glBindVertexArray(vertexArrayObject);
+      GLState::bindVertexArray(vertexArrayObject);
     }
 
     // Override Virtual Shutdown Function
     void shutdown() {
       // shader cleanup
-      glDeleteVertexArrays(1, &vertexArrayObject);
       glDeleteProgram(renderingProgram);
+      GLState::programDeleted(renderingProgram);
       glDeleteVertexArrays(1, &vertexArrayObject);
+      GLState::vertexArrayDeleted(vertexArrayObject);
     }
 
     // Override Virtual Render Function
@@ -99,7 +100,8 @@ public:
         glClearBufferfv(GL_COLOR, 0, green);
 
         // Use the program we created earlier for rendering
-        glUseProgram(renderingProgram);
+        // (through GLState, the call is skipped when it's already current)
+        GLState::useProgram(renderingProgram);
 
         // Draw one triangle
         glDrawArrays(GL_TRIANGLES, 0, 3);
@@ -1,4 +1,7 @@
 #include <Engine.hpp>
+#include <InstanceBuffer.hpp>
+#include <stdlib.h>
+#include <string>
 
 /*
   Vertex shader is the only mandatory stage in the OpenGL pipeline
@@ -15,8 +18,23 @@ class PipelinePassingData : public Engine {
 private:
     GLuint renderingProgram;
     GLuint vertexArrayObject;
+    InstanceBuffer instanceBuffer;
+    int instanceCount;
 
 public:
+    PipelinePassingData() : instanceCount(1) {}
+
+    // --instances N draws N moving triangles, the rest goes to the engine (--headless, ...)
+    void parseArguments(int argc, const char **argv) {
+      std::vector<const char *> rest(1, argv[0]);
+      for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--instances" && i + 1 < argc) instanceCount = atoi(argv[++i]);
+        else rest.push_back(argv[i]);
+      }
+      if (instanceCount < 1) instanceCount = 1;
+      Engine::parseArguments((int)rest.size(), rest.data());
+    }
+
     void startup() {
       // Source code for vertex shader
       static const GLchar * vertexShaderSource[] =
@@ -77,15 +95,27 @@ public:
 
       // Create a VAO
       glGenVertexArrays(1, &vertexArrayObject);
-      glBindVertexArray(vertexArrayObject);
+      GLState::bindVertexArray(vertexArrayObject);
+
+      // Per-frame attribute data goes through an instance stream instead of glVertexAttrib4fv
+      // divisor 1 -> the attribute advances per instance, so all 3 vertices read the same value
+      // one instance = offset (vec4) + color (vec4)
+      const VertexAttribute perInstance[] = {
+        {0, 4, GL_FLOAT, GL_FALSE, 0},
+        {1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat)}
+      };
+      instanceBuffer.create(perInstance, 2, 8 * sizeof(GLfloat), instanceCount);
+      instanceBuffer.attach(vertexArrayObject);
     }
 
     // Override Virtual Shutdown Function
     void shutdown() {
       // Delete program object
-      glDeleteVertexArrays(1, &vertexArrayObject);
+      instanceBuffer.destroy();
       glDeleteProgram(renderingProgram);
+      GLState::programDeleted(renderingProgram);
       glDeleteVertexArrays(1, &vertexArrayObject);
+      GLState::vertexArrayDeleted(vertexArrayObject);
     }
 
     // Override Virtual Render Function
@@ -94,22 +124,36 @@ public:
         glClearBufferfv(GL_COLOR, 0, green);
 
         // Use the program we created earlier for rendering
-        glUseProgram(renderingProgram);
-
-        GLfloat attrib[] = { (float)sin(currentTime) * 0.5f,
-                             (float)cos(currentTime) * 0.6f,
-                             0.0f, 0.0f };
-
-        // Update the value of input attribute 0
-        // Parameter index is used to reference the attribute
-        // v is a pointer to the new data to put into the attribute
-
-        // Each time glVertexAttrib is called it will update the value
-        // of the vertex attribute that is passed to the vertex shader
-        glVertexAttrib4fv(0, attrib);
-
-        // Draw one triangle
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        // (through GLState, the call is skipped when it's already current)
+        GLState::useProgram(renderingProgram);
+
+        // Update the value of input attribute 0 (offset) and 1 (color) for every instance
+        // glVertexAttrib4fv(index, v) sets one constant value and goes through the driver every call,
+        // here the data is written straight into this frame's slice of the instance stream
+        GLfloat *attrib = (GLfloat *)instanceBuffer.begin(instanceCount);
+        if (attrib) {
+            // Instance 0 is the original triangle, the others follow it on a phase-shifted path
+            jobs.parallelFor(0, instanceCount, 4096, [&](int begin, int end) {
+                for (int i = begin; i < end; i++) {
+                    double t = currentTime + i * 0.001;
+                    float scale = 1.0f - (float)(i % 64) / 80.0f;
+                    GLfloat *a = attrib + i * 8;
+                    a[0] = (float)sin(t) * 0.5f * scale;
+                    a[1] = (float)cos(t * (1.0 + (i % 7) * 0.1)) * 0.6f * scale;
+                    a[2] = 0.0f;
+                    a[3] = 0.0f;
+                    // color
+                    a[4] = (float)sin(t) * 0.5f + 0.5f;
+                    a[5] = (float)cos(t) * 0.5f + 0.5f;
+                    a[6] = 0.0f;
+                    a[7] = 1.0f;
+                }
+            });
+
+            // Draw instanceCount triangles with one call
+            instanceBuffer.drawArrays(GL_TRIANGLES, 0, 3);
+        }
+        instanceBuffer.end();
     }
 };
 
@@ -83,15 +83,16 @@ public:
 
       // Create a VAO
       glGenVertexArrays(1, &vertexArrayObject);
-      glBindVertexArray(vertexArrayObject);
+      GLState::bindVertexArray(vertexArrayObject);
     }
 
     // Override Virtual Shutdown Function
     void shutdown() {
       // Delete program object
-      glDeleteVertexArrays(1, &vertexArrayObject);
       glDeleteProgram(renderingProgram);
+      GLState::programDeleted(renderingProgram);
       glDeleteVertexArrays(1, &vertexArrayObject);
+      GLState::vertexArrayDeleted(vertexArrayObject);
     }
 
     // Override Virtual Render Function
@@ -100,7 +101,8 @@ public:
         glClearBufferfv(GL_COLOR, 0, green);
 
         // Use the program we created earlier for rendering
-        glUseProgram(renderingProgram);
+        // (through GLState, the call is skipped when it's already current)
+        GLState::useProgram(renderingProgram);
 
         GLfloat attrib[] = { (float)sin(currentTime) * 0.5f,
                              (float)cos(currentTime) * 0.6f,
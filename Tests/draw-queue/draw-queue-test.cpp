@@ -0,0 +1,112 @@
+#include <DrawQueue.hpp>
+#include <cstdio>
+
+/*
+  Draw queue test, CPU only: sort() / order() and the merge decisions of plan(), no GL context needed.
+  Sorting has to follow the key and keep submission order for equal keys (the radix sort is stable).
+  Merging has to:
+  - merge consecutive instance ranges of the same geometry into one instanced draw
+  - collect single instances without instanceOffset into one multi-draw
+  - never merge across a pass, and report the pass change so the pass callback runs
+*/
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+    if (!condition) {
+        printf("  %s\n", what);
+        failures++;
+    }
+}
+
+static void testSort() {
+    DrawQueue queue;
+    // Submitted out of order, items 1 and 3 share a key
+    queue.submit(DrawQueue::item(DrawQueue::key(1, 2, 0, 1, 0.5f), 2, 1, GL_TRIANGLES, 0, 3));
+    queue.submit(DrawQueue::item(DrawQueue::key(0, 7, 3, 1, 0.9f), 7, 1, GL_TRIANGLES, 0, 3));
+    queue.submit(DrawQueue::item(DrawQueue::key(0, 7, 3, 1, 0.1f), 7, 1, GL_TRIANGLES, 0, 3));
+    queue.submit(DrawQueue::item(DrawQueue::key(0, 7, 3, 1, 0.9f), 7, 1, GL_TRIANGLES, 0, 3));
+    queue.submit(DrawQueue::item(DrawQueue::key(0, 1, 9, 4, 1.0f), 1, 4, GL_TRIANGLES, 0, 3));
+    queue.sort();
+
+    const std::vector<unsigned> &order = queue.order();
+    const unsigned expected[] = {4, 2, 1, 3, 0};
+    bool same = order.size() == 5;
+    for (size_t i = 0; same && i < order.size(); i++) same = order[i] == expected[i];
+    check(same, "sort: wrong order (or equal keys swapped)");
+
+    check(DrawQueue::pass(DrawQueue::key(9, 0xFFFF, 0, 0, 0.0f)) == 9, "key: pass doesn't survive a wide program id");
+    check(DrawQueue::key(0, 0, 0, 0, -1.0f) == DrawQueue::key(0, 0, 0, 0, 0.0f), "key: depth below 0 not clamped");
+    check(DrawQueue::key(0, 0, 0, 0, 2.0f) == DrawQueue::key(0, 0, 0, 0, 1.0f), "key: depth above 1 not clamped");
+}
+
+// Shares every field the merge looks at, only geometry / instances differ
+static DrawItem instanced(unsigned pass, GLuint first, GLuint instance, GLsizei instanceCount, GLint instanceOffset) {
+    DrawItem item = DrawQueue::item(DrawQueue::key(pass, 1, 0, 1, 0.0f), 1, 1, GL_TRIANGLES, first, 6);
+    item.instance = instance;
+    item.instanceCount = instanceCount;
+    item.instanceOffset = instanceOffset;
+    return item;
+}
+
+static void testMerge() {
+    DrawQueue queue;
+
+    // Consecutive instance ranges 0..3, 3..4, 4..8 of one mesh -> one draw of 8
+    queue.submit(instanced(0, 0, 0, 3, 5));
+    queue.submit(instanced(0, 0, 3, 1, 5));
+    queue.submit(instanced(0, 0, 4, 4, 5));
+    // Gap in the instances -> a new draw
+    queue.submit(instanced(0, 0, 10, 2, 5));
+    queue.plan();
+    const std::vector<DrawBatch> &ranges = queue.batches();
+    check(ranges.size() == 2, "instances: expected 2 draws");
+    if (ranges.size() == 2) {
+        check(!ranges[0].multi && ranges[0].instance == 0 && ranges[0].instanceCount == 8, "instances: first draw not 0 + 8");
+        check(!ranges[1].multi && ranges[1].instance == 10 && ranges[1].instanceCount == 2, "instances: second draw not 10 + 2");
+        check(ranges[0].changes == (DrawBatch::PASS_CHANGED | DrawBatch::PROGRAM_CHANGED |
+                                    DrawBatch::MATERIAL_CHANGED | DrawBatch::VERTEX_ARRAY_CHANGED),
+              "instances: first draw doesn't set all state");
+        check(ranges[1].changes == 0, "instances: state set again inside one run");
+    }
+    queue.clear();
+
+    // Different meshes, single instances without instanceOffset -> one multi-draw
+    queue.submit(instanced(0, 0, 0, 1, -1));
+    queue.submit(instanced(0, 6, 0, 1, -1));
+    queue.submit(instanced(0, 12, 0, 1, -1));
+    // Several instances can't go into the multi-draw, it ends the run of collected items
+    queue.submit(instanced(0, 18, 0, 4, -1));
+    queue.submit(instanced(0, 24, 0, 1, -1));
+    queue.plan();
+    const std::vector<DrawBatch> &multi = queue.batches();
+    check(multi.size() == 3, "multi-draw: expected 3 draws");
+    if (multi.size() == 3) {
+        check(multi[0].multi && multi[0].begin == 0 && multi[0].end == 3, "multi-draw: first 3 items not collected");
+        check(!multi[1].multi && multi[1].instanceCount == 4, "multi-draw: instanced item not drawn on its own");
+        check(multi[2].multi && multi[2].end - multi[2].begin == 1, "multi-draw: last item lost");
+    }
+    queue.clear();
+
+    // Same state in two passes -> two draws, the second one changes the pass only
+    queue.submit(instanced(1, 0, 0, 1, 5));
+    queue.submit(instanced(0, 0, 1, 1, 5));
+    queue.plan();
+    const std::vector<DrawBatch> &passes = queue.batches();
+    check(passes.size() == 2, "passes: merged across a pass");
+    if (passes.size() == 2) {
+        check(passes[1].changes == DrawBatch::PASS_CHANGED, "passes: second pass not reported");
+    }
+}
+
+int main() {
+    testSort();
+    testMerge();
+
+    if (failures) {
+        printf("FAILED, %d checks\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <JobSystem.hpp>
+#include <cstdio>
+#include <vector>
+
+/*
+  Job system stress test
+  parallelFor with grain 1 keeps far more than JobQueue::CAPACITY jobs outstanding, so the deques
+  overflow (owner runs inline) and get stolen from while they refill.
+  Every index has to run exactly once.
+
+  Dependencies: a chain of jobs where each one waits on the counter of the one before, submitted
+  in order so the dependent job sits on top of the deque. Has to finish on 0 workers too, and
+  every job has to see its predecessor done.
+*/
+
+static const int ELEMENTS = 1 << 18;
+static const int REPEATS = 8;
+
+static int runOnce(JobSystem &jobs, std::vector<std::atomic<int> > &runs) {
+    for (int i = 0; i < ELEMENTS; i++) runs[i].store(0);
+
+    jobs.parallelFor(0, ELEMENTS, 1, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) runs[i].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    int lost = 0;
+    int repeated = 0;
+    for (int i = 0; i < ELEMENTS; i++) {
+        int count = runs[i].load();
+        if (count == 0) lost++;
+        if (count > 1) repeated++;
+    }
+    if (lost || repeated) printf("  %d indices never ran, %d ran more than once\n", lost, repeated);
+    return lost + repeated;
+}
+
+static const int CHAIN = 64;
+
+struct ChainLink {
+    std::atomic<int> *finished;  // number of links done so far
+    int position;
+    int *outOfOrder;
+};
+
+static void chainJob(void *data, int, int) {
+    ChainLink *link = (ChainLink *)data;
+    if (link->finished->load() != link->position) (*link->outOfOrder)++;
+    link->finished->fetch_add(1);
+}
+
+static int runChain(JobSystem &jobs) {
+    std::atomic<int> finished(0);
+    int outOfOrder = 0;
+    std::vector<ChainLink> links(CHAIN);
+    std::vector<JobCounter> counters(CHAIN);
+
+    for (int i = 0; i < CHAIN; i++) {
+        links[i].finished = &finished;
+        links[i].position = i;
+        links[i].outOfOrder = &outOfOrder;
+        jobs.run(&chainJob, &links[i], 0, 1, &counters[i], i > 0 ? &counters[i - 1] : NULL);
+    }
+    jobs.wait(&counters[CHAIN - 1]);
+
+    if (outOfOrder) printf("  %d chain jobs ran before their dependency\n", outOfOrder);
+    return outOfOrder;
+}
+
+int main(int argc, const char **argv) {
+    std::vector<std::atomic<int> > runs(ELEMENTS);
+    int failures = 0;
+
+    for (int workers = 0; workers <= 3; workers++) {
+        JobSystem jobs;
+        jobs.start(workers);
+        printf("%d workers, %d jobs x %d, dependency chain of %d\n", workers, ELEMENTS, REPEATS, CHAIN);
+        for (int r = 0; r < REPEATS; r++) failures += runOnce(jobs, runs);
+        for (int r = 0; r < REPEATS; r++) failures += runChain(jobs);
+        jobs.stop();
+    }
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+#include <TripleBuffer.hpp>
+#include <cstdio>
+#include <thread>
+
+/*
+  Triple buffer test
+  One thread publishes numbered packets as fast as it can while another acquires them.
+  Every packet the consumer reads has to be complete (all fields from one publish), newer than
+  the one before, and the last one published has to arrive.
+*/
+
+static const int PACKETS = 1 << 20;
+static const int FIELDS = 15;
+
+struct Packet {
+    int sequence;
+    int copies[FIELDS];  // all equal to sequence, anything else is a torn read
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+    if (!condition) {
+        printf("  %s\n", what);
+        failures++;
+    }
+}
+
+static void publish(TripleBuffer<Packet> &buffer, int sequence) {
+    Packet &packet = buffer.write();
+    packet.sequence = sequence;
+    for (int i = 0; i < FIELDS; i++) packet.copies[i] = sequence;
+    buffer.publish();
+}
+
+static void testSingleThread() {
+    TripleBuffer<Packet> buffer;
+    check(!buffer.acquire(), "acquire before any publish returned true");
+
+    publish(buffer, 1);
+    publish(buffer, 2);
+    check(buffer.acquire() && buffer.read().sequence == 2, "acquire didn't return the latest packet");
+    check(!buffer.acquire(), "acquire returned true twice for one publish");
+    check(buffer.read().sequence == 2, "read() changed without a new acquire");
+}
+
+static void testTwoThreads() {
+    TripleBuffer<Packet> buffer;
+    std::thread producer([&buffer]() {
+        for (int s = 1; s <= PACKETS; s++) publish(buffer, s);
+    });
+
+    int last = 0;
+    int received = 0;
+    int torn = 0;
+    int backwards = 0;
+    while (last < PACKETS) {
+        if (!buffer.acquire()) continue;
+        const Packet &packet = buffer.read();
+        for (int i = 0; i < FIELDS; i++) {
+            if (packet.copies[i] != packet.sequence) {
+                torn++;
+                break;
+            }
+        }
+        if (packet.sequence <= last) backwards++;
+        else last = packet.sequence;
+        received++;
+    }
+    producer.join();
+
+    if (torn || backwards) printf("  %d torn packets, %d not newer than the one before\n", torn, backwards);
+    failures += torn + backwards;
+    check(!buffer.acquire(), "acquire returned true after the last packet was read");
+    printf("  %d of %d packets seen\n", received, PACKETS);
+}
+
+int main() {
+    testSingleThread();
+    testTwoThreads();
+
+    if (failures) {
+        printf("FAILED, %d checks\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
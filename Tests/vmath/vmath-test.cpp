@@ -0,0 +1,77 @@
+#include <VectorMath.hpp>
+#include <cstdio>
+
+/*
+  vmath constructors and inverse
+  Built twice (SIMD and VMATH_NO_SIMD), both have to agree: a singular mat4 inverts to the zero
+  matrix like the generic Gauss-Jordan template, and mat4(1.0f) is the identity.
+*/
+
+using namespace vmath;
+
+static int failures = 0;
+
+static void check(bool condition, const char *what) {
+    if (!condition) {
+        printf("  failed: %s\n", what);
+        failures++;
+    }
+}
+
+template <typename T>
+static bool equals(const matNM<T, 4, 4> &a, const matNM<T, 4, 4> &b, T tolerance) {
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            if (!(fabs(a[c][r] - b[c][r]) <= tolerance)) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, const char **argv) {
+#ifdef VMATH_SSE
+#ifdef VMATH_AVX
+    printf("vmath AVX\n");
+#else
+    printf("vmath SSE\n");
+#endif
+#else
+    printf("vmath scalar\n");
+#endif
+
+    // Diagonal / broadcast constructors
+    mat4 identity(1.0f);
+    mat4 zero(0.0f);
+    check(equals<float>(identity, matNM<float, 4, 4>::identity(), 0.0f), "mat4(1.0f) is the identity");
+    check(equals<float>(mat4(vec4(1, 0, 0, 0), vec4(0, 1, 0, 0), vec4(0, 0, 1, 0), vec4(0, 0, 0, 1)), identity, 0.0f),
+          "column constructor matches mat4(1.0f)");
+    check(equals<float>(zero, identity * 0.0f, 0.0f), "mat4(0.0f) is all zeros");
+    check(equals<double>(dmat4(1.0), matNM<double, 4, 4>::identity(), 0.0), "dmat4(1.0) is the identity");
+    vec4 twos(2.0f);
+    check(twos[0] == 2.0f && twos[1] == 2.0f && twos[2] == 2.0f && twos[3] == 2.0f, "vec4(2.0f) broadcasts");
+    check(vec3(1.0f)[2] == 1.0f && vec2(3.0f)[1] == 3.0f, "vec2 / vec3 broadcast");
+    check(mat3(1.0f)[1][1] == 1.0f && mat3(1.0f)[0][1] == 0.0f, "mat3(1.0f) is the identity");
+
+    // Singular: two equal columns, a zero column, all zeros
+    mat4 singular[3] = {
+        mat4(vec4(1, 2, 3, 4), vec4(1, 2, 3, 4), vec4(0, 1, 0, 0), vec4(0, 0, 1, 1)),
+        mat4(vec4(1, 0, 0, 0), vec4(0, 1, 0, 0), vec4(0, 0, 0, 0), vec4(5, 6, 7, 1)),
+        zero
+    };
+    for (int i = 0; i < 3; i++) {
+        check(equals<float>(inverse(singular[i]), zero, 0.0f), "singular mat4 inverts to zero");
+        dmat4 d;
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) d[c][r] = singular[i][c][r];
+        }
+        check(equals<double>(inverse(d), dmat4(0.0), 0.0), "singular dmat4 (Gauss-Jordan) inverts to zero");
+    }
+
+    // Regular matrices still invert
+    mat4 m = translate(1.0f, 2.0f, 3.0f) * rotate(30.0f, 0.0f, 1.0f, 0.0f) * scale(2.0f, 3.0f, 4.0f);
+    check(equals<float>(mat4(m * inverse(m)), identity, 1e-5f), "m * inverse(m) is the identity");
+    check(equals<float>(inverse(identity), identity, 0.0f), "inverse(identity) is the identity");
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
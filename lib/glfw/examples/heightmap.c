@@ -28,6 +28,7 @@
 #include <math.h>
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -113,6 +114,27 @@ static GLuint  map_line_indices[2*MAP_NUM_LINES];
 static GLuint mesh;
 static GLuint mesh_vbo[4];
 
+/* Heights are streamed through a persistently mapped ring (GL_ARB_buffer_storage)
+ * when the driver has it: MESH_REGIONS copies of the height array, the CPU fills
+ * the next one while the GPU may still draw from the previous, fences keep them
+ * apart. Without the extension update_mesh falls back to glBufferSubData.
+ */
+#define MESH_REGIONS 3
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRYP PFN_BUFFER_STORAGE)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static GLfloat* mesh_heights = NULL;
+static GLsync mesh_fences[MESH_REGIONS];
+static int mesh_region = 0;
+static GLint mesh_height_attrloc;
+
 /**********************************************************************
  * OpenGL helper functions
  *********************************************************************/
@@ -363,8 +385,23 @@ static void make_mesh(GLuint program)
     glVertexAttribPointer(attrloc, 1, GL_FLOAT, GL_FALSE, 0, 0);
 
     attrloc = glGetAttribLocation(program, "y");
+    mesh_height_attrloc = attrloc;
     glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES, &map_vertices[1][0], GL_DYNAMIC_DRAW);
+    if (glfwExtensionSupported("GL_ARB_buffer_storage"))
+    {
+        PFN_BUFFER_STORAGE buffer_storage = (PFN_BUFFER_STORAGE) glfwGetProcAddress("glBufferStorage");
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES * MESH_REGIONS;
+        if (buffer_storage)
+        {
+            buffer_storage(GL_ARRAY_BUFFER, size, NULL, flags);
+            mesh_heights = (GLfloat*) glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        }
+    }
+    if (mesh_heights)
+        memcpy(mesh_heights, &map_vertices[1][0], sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES);
+    else
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES, &map_vertices[1][0], GL_DYNAMIC_DRAW);
     glEnableVertexAttribArray(attrloc);
     glVertexAttribPointer(attrloc, 1, GL_FLOAT, GL_FALSE, 0, 0);
 }
@@ -373,7 +410,31 @@ static void make_mesh(GLuint program)
  */
 static void update_mesh(void)
 {
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES, &map_vertices[1][0]);
+    GLfloat* region;
+
+    if (!mesh_heights)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES, &map_vertices[1][0]);
+        return;
+    }
+
+    /* Every draw so far used the current region, fence it and move on */
+    mesh_fences[mesh_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mesh_region = (mesh_region + 1) % MESH_REGIONS;
+
+    /* Only waits when the GPU is still MESH_REGIONS updates behind */
+    if (mesh_fences[mesh_region])
+    {
+        while (glClientWaitSync(mesh_fences[mesh_region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(mesh_fences[mesh_region]);
+        mesh_fences[mesh_region] = 0;
+    }
+
+    region = mesh_heights + mesh_region * MAP_NUM_TOTAL_VERTICES;
+    memcpy(region, &map_vertices[1][0], sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES);
+    glVertexAttribPointer(mesh_height_attrloc, 1, GL_FLOAT, GL_FALSE, 0,
+                          (void*) (sizeof(GLfloat) * MAP_NUM_TOTAL_VERTICES * mesh_region));
 }
 
 /**********************************************************************
@@ -42,6 +42,13 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+// The physics runs 8 particles at a time with AVX where the CPU has it,
+// picked at runtime so the binary still runs everywhere
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #include <immintrin.h>
+ #define PARTICLES_AVX
+#endif
+
 // Define tokens for GL_EXT_separate_specular_color if not already defined
 #ifndef GL_EXT_separate_specular_color
 #define GL_LIGHT_MODEL_COLOR_CONTROL_EXT  0x81F8
@@ -80,20 +87,71 @@ typedef struct
 
 // Window dimensions
 float aspect_ratio;
+int viewport_height;
 
 // "wireframe" flag (true if we use wireframe view)
 int wireframe;
 
 // Thread synchronization
+// The physics thread hands finished frames to the draw loop through a
+// lock-free triple buffer of particle snapshots: it fills its back snapshot
+// while the draw loop reads the front one, and publishing swaps the back
+// snapshot with the middle one in a single atomic exchange. Neither side
+// ever holds a lock on the other's data or waits for the other: physics
+// runs on its own clock and a snapshot the draw loop didn't get to in time
+// is simply replaced by the next one.
+typedef struct
+{
+    float*  x;            // Particle positions
+    float*  y;
+    float*  z;
+    GLuint* rgba;         // Color and intensity, packed like in Vertex
+    int     count;        // Number of particles
+    float   glow_pos[4];  // Fountain lighting from the latest born particle
+    float   glow_color[4];
+} SNAPSHOT;
+
+#define SNAPSHOT_INDEX 3  // Index bits of snapshots.middle
+#define SNAPSHOT_FRESH 4  // Set while the middle snapshot hasn't been drawn
+
+struct {
+    SNAPSHOT  buffers[3];
+    int       middle;    // Index | SNAPSHOT_FRESH, only accessed atomically
+    char      middle_padding[64];
+    int       back;      // Only touched by the physics thread
+    char      back_padding[64];
+    int       front;     // Only touched by the draw loop
+} snapshots;
+
+// How the two clocks line up
+struct {
+    int       steps;          // Snapshots published by the physics thread
+    int       dropped;        // Snapshots replaced before the draw loop took them
+    int       frames;         // Frames drawn
+    int       stale_frames;   // Frames that found no new snapshot and drew the old one again
+    double    draw_stall;     // Time covered by those stale frames (s)
+} handoff_stats;
+
+// Where the particle physics runs, switched at runtime with G
+#define SIMULATION_CPU 0
+#define SIMULATION_GPU 1
+
+static int simulation_mode = SIMULATION_CPU;  // Only accessed atomically
+
+// Frames drawn and time spent per simulation mode, for A/B comparisons
 struct {
-    double    t;         // Time (s)
-    float     dt;        // Time since last frame (s)
-    int       p_frame;   // Particle physics frame number
-    int       d_frame;   // Particle draw frame number
-    cnd_t     p_done;    // Condition: particle physics done
-    cnd_t     d_done;    // Condition: particle draw done
-    mtx_t     particles_lock; // Particles data sharing mutex
-} thread_sync;
+    int       frames;
+    double    time;
+} mode_stats[2];
+
+#if defined(_MSC_VER)
+ #include <intrin.h>
+ #define ATOMIC_LOAD(p)        _InterlockedOr((volatile long*) (p), 0)
+ #define ATOMIC_EXCHANGE(p, v) _InterlockedExchange((volatile long*) (p), (v))
+#else
+ #define ATOMIC_LOAD(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+ #define ATOMIC_EXCHANGE(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#endif
 
 
 //========================================================================
@@ -147,15 +205,12 @@ const unsigned char floor_texture[ F_TEX_WIDTH * F_TEX_HEIGHT ] = {
 // modular world, these values should be variables...
 //========================================================================
 
-// Maximum number of particles
+// Default maximum number of particles (change it with -n)
 #define MAX_PARTICLES   3000
 
 // Life span of a particle (in seconds)
 #define LIFE_SPAN       8.f
 
-// A new particle is born every [BIRTH_INTERVAL] second
-#define BIRTH_INTERVAL (LIFE_SPAN/(float)MAX_PARTICLES)
-
 // Particle size (meters)
 #define PARTICLE_SIZE   0.7f
 
@@ -174,31 +229,48 @@ const unsigned char floor_texture[ F_TEX_WIDTH * F_TEX_HEIGHT ] = {
 // Fountain radius (m)
 #define FOUNTAIN_RADIUS 1.6f
 
-// Minimum delta-time for particle phisics (s)
-#define MIN_DELTA_T     (BIRTH_INTERVAL * 0.5f)
+// Maximum delta-time for particle physics (s), longer frames are split.
+// Births are spread over the step on their own, so the step no longer has
+// to shrink with the birth interval
+#define MAX_DELTA_T     (1.f / 60.f)
 
 
 //========================================================================
 // Particle system global variables
 //========================================================================
 
-// This structure holds all state for a single particle
+// All live particles, one array per field (structure of arrays) so the
+// physics can load 8 particles of a field with one instruction. Particles
+// [0, count) are alive: a dying particle is replaced by the last one
+// (swap-remove), so there are no holes and no "active" flag to test.
 typedef struct {
-    float x,y,z;     // Position in space
-    float vx,vy,vz;  // Velocity vector
-    float r,g,b;     // Color of particle
-    float life;      // Life of particle (1.0 = newborn, < 0.0 = dead)
-    int   active;    // Tells if this particle is active
-} PARTICLE;
+    float *x, *y, *z;     // Position in space
+    float *vx, *vy, *vz;  // Velocity vector
+    float *r, *g, *b;     // Color of particle
+    float *life;          // Life of particle (1.0 = newborn, <= 0.0 = dead)
+    int   count;          // Number of live particles
+    int   capacity;       // Allocated size, a multiple of 8
+} PARTICLES;
 
-// Global vectors holding all particles. We use two vectors for double
-// buffering.
-static PARTICLE particles[MAX_PARTICLES];
+static PARTICLES particles;
+
+// Maximum number of particles and the matching birth interval (a new
+// particle is born every [birth_interval] second)
+static int   max_particles = MAX_PARTICLES;
+static float birth_interval;
+
+// Blocks of 8 particles that had a death during the last physics step
+static int* dead_blocks;
+static int  dead_block_count;
+
+// Set when the CPU supports AVX
+static int use_avx;
 
 // Global variable holding the age of the youngest particle
 static float min_age;
 
-// Color of latest born particle (used for fountain lighting)
+// Color of latest born particle (used for fountain lighting, the draw loop
+// gets it through the snapshots)
 static float glow_color[4];
 
 // Position of latest born particle (used for fountain lighting)
@@ -224,117 +296,281 @@ const GLfloat fog_color[4]         = { 0.1f, 0.1f, 0.1f, 1.f };
 
 static void usage(void)
 {
-    printf("Usage: particles [-bfhs]\n");
+    printf("Usage: particles [-bfgh] [-n count]\n");
     printf("Options:\n");
+    printf(" -b   Benchmark particle spawning against the pool size and exit\n");
     printf(" -f   Run in full screen\n");
+    printf(" -g   Start with the GPU simulation (transform feedback, GL 3.0)\n");
     printf(" -h   Display this help\n");
-    printf(" -s   Run program as single thread (default is to use two threads)\n");
+    printf(" -n   Maximum number of particles (default %d)\n", MAX_PARTICLES);
     printf("\n");
     printf("Program runtime controls:\n");
+    printf(" G    Toggle CPU / GPU simulation\n");
     printf(" W    Toggle wireframe mode\n");
     printf(" Esc  Exit program\n");
 }
 
 
+//========================================================================
+// Allocate / free the particle arrays
+//========================================================================
+
+// Every per-particle array, for the code that treats them all alike
+#define PARTICLE_FIELDS 10
+
+static float** const particle_fields[PARTICLE_FIELDS] =
+{
+    &particles.x,  &particles.y,  &particles.z,
+    &particles.vx, &particles.vy, &particles.vz,
+    &particles.r,  &particles.g,  &particles.b,
+    &particles.life
+};
+
+static void alloc_particles(int count)
+{
+    int i;
+
+    // Rounded up to whole vectors, the AVX kernel never needs a scalar tail
+    particles.capacity = (count + 7) & ~7;
+    particles.count = 0;
+    for (i = 0;  i < PARTICLE_FIELDS;  i++)
+        *particle_fields[i] = calloc(particles.capacity, sizeof(float));
+
+    dead_blocks = calloc(particles.capacity / 8, sizeof(int));
+    dead_block_count = 0;
+    birth_interval = LIFE_SPAN / (float) count;
+}
+
+static void free_particles(void)
+{
+    int i;
+
+    for (i = 0;  i < PARTICLE_FIELDS;  i++)
+    {
+        free(*particle_fields[i]);
+        *particle_fields[i] = NULL;
+    }
+
+    free(dead_blocks);
+    dead_blocks = NULL;
+    particles.count = particles.capacity = 0;
+}
+
+//========================================================================
+// Particle pool
+// The live particles are always [0, count) and the free slots [count,
+// capacity), so the free list is just that range: spawning n particles
+// takes the next n slots and freeing one moves the last live particle into
+// its place. Both cost the same whatever the pool size.
+//========================================================================
+
+// Take n free slots, they become particles [*first, *first + spawned).
+// Returns the number spawned, fewer than n when the pool is full
+static int spawn_particles(int n, int* first)
+{
+    int room = max_particles - particles.count;
+
+    if (n > room)
+        n = room;
+
+    *first = particles.count;
+    particles.count += n;
+    return n;
+}
+
+// Copy particle [from] over particle [to]
+static void move_particle(int from, int to)
+{
+    int i;
+
+    for (i = 0;  i < PARTICLE_FIELDS;  i++)
+        (*particle_fields[i])[to] = (*particle_fields[i])[from];
+}
+
+
 //========================================================================
 // Initialize a new particle
 //========================================================================
 
-static void init_particle(PARTICLE *p, double t)
+static void init_particle(int i, double t)
 {
     float xy_angle, velocity;
 
     // Start position of particle is at the fountain blow-out
-    p->x = 0.f;
-    p->y = 0.f;
-    p->z = FOUNTAIN_HEIGHT;
+    particles.x[i] = 0.f;
+    particles.y[i] = 0.f;
+    particles.z[i] = FOUNTAIN_HEIGHT;
 
     // Start velocity is up (Z)...
-    p->vz = 0.7f + (0.3f / 4096.f) * (float) (rand() & 4095);
+    particles.vz[i] = 0.7f + (0.3f / 4096.f) * (float) (rand() & 4095);
 
     // ...and a randomly chosen X/Y direction
     xy_angle = (2.f * (float) M_PI / 4096.f) * (float) (rand() & 4095);
-    p->vx = 0.4f * (float) cos(xy_angle);
-    p->vy = 0.4f * (float) sin(xy_angle);
+    particles.vx[i] = 0.4f * (float) cos(xy_angle);
+    particles.vy[i] = 0.4f * (float) sin(xy_angle);
 
     // Scale velocity vector according to a time-varying velocity
     velocity = VELOCITY * (0.8f + 0.1f * (float) (sin(0.5 * t) + sin(1.31 * t)));
-    p->vx *= velocity;
-    p->vy *= velocity;
-    p->vz *= velocity;
+    particles.vx[i] *= velocity;
+    particles.vy[i] *= velocity;
+    particles.vz[i] *= velocity;
 
     // Color is time-varying
-    p->r = 0.7f + 0.3f * (float) sin(0.34 * t + 0.1);
-    p->g = 0.6f + 0.4f * (float) sin(0.63 * t + 1.1);
-    p->b = 0.6f + 0.4f * (float) sin(0.91 * t + 2.1);
+    particles.r[i] = 0.7f + 0.3f * (float) sin(0.34 * t + 0.1);
+    particles.g[i] = 0.6f + 0.4f * (float) sin(0.63 * t + 1.1);
+    particles.b[i] = 0.6f + 0.4f * (float) sin(0.91 * t + 2.1);
 
     // Store settings for fountain glow lighting
     glow_pos[0] = 0.4f * (float) sin(1.34 * t);
     glow_pos[1] = 0.4f * (float) sin(3.11 * t);
     glow_pos[2] = FOUNTAIN_HEIGHT + 1.f;
     glow_pos[3] = 1.f;
-    glow_color[0] = p->r;
-    glow_color[1] = p->g;
-    glow_color[2] = p->b;
+    glow_color[0] = particles.r[i];
+    glow_color[1] = particles.g[i];
+    glow_color[2] = particles.b[i];
     glow_color[3] = 1.f;
 
-    // The particle is new-born and active
-    p->life = 1.f;
-    p->active = 1;
+    // The particle is new-born
+    particles.life[i] = 1.f;
 }
 
 
 //========================================================================
-// Update a particle
+// Update particles [begin, end), one at a time
 //========================================================================
 
 #define FOUNTAIN_R2 (FOUNTAIN_RADIUS+PARTICLE_SIZE/2)*(FOUNTAIN_RADIUS+PARTICLE_SIZE/2)
 
-static void update_particle(PARTICLE *p, float dt)
+static void update_particles(int begin, int end, float dt)
 {
-    // If the particle is not active, we need not do anything
-    if (!p->active)
-        return;
-
-    // The particle is getting older...
-    p->life -= dt * (1.f / LIFE_SPAN);
+    int i;
 
-    // Did the particle die?
-    if (p->life <= 0.f)
+    for (i = begin;  i < end;  i++)
     {
-        p->active = 0;
-        return;
-    }
+        // The particle is getting older...
+        particles.life[i] -= dt * (1.f / LIFE_SPAN);
 
-    // Apply gravity
-    p->vz = p->vz - GRAVITY * dt;
+        // Did the particle die? It's removed after the whole step
+        if (particles.life[i] <= 0.f)
+        {
+            if (dead_block_count == 0 || dead_blocks[dead_block_count - 1] != i / 8)
+                dead_blocks[dead_block_count++] = i / 8;
+            continue;
+        }
 
-    // Update particle position
-    p->x = p->x + p->vx * dt;
-    p->y = p->y + p->vy * dt;
-    p->z = p->z + p->vz * dt;
+        // Apply gravity
+        particles.vz[i] = particles.vz[i] - GRAVITY * dt;
 
-    // Simple collision detection + response
-    if (p->vz < 0.f)
-    {
-        // Particles should bounce on the fountain (with friction)
-        if ((p->x * p->x + p->y * p->y) < FOUNTAIN_R2 &&
-            p->z < (FOUNTAIN_HEIGHT + PARTICLE_SIZE / 2))
+        // Update particle position
+        particles.x[i] = particles.x[i] + particles.vx[i] * dt;
+        particles.y[i] = particles.y[i] + particles.vy[i] * dt;
+        particles.z[i] = particles.z[i] + particles.vz[i] * dt;
+
+        // Simple collision detection + response
+        if (particles.vz[i] < 0.f)
         {
-            p->vz = -FRICTION * p->vz;
-            p->z  = FOUNTAIN_HEIGHT + PARTICLE_SIZE / 2 +
-                    FRICTION * (FOUNTAIN_HEIGHT +
-                    PARTICLE_SIZE / 2 - p->z);
+            // Particles should bounce on the fountain (with friction)
+            if ((particles.x[i] * particles.x[i] + particles.y[i] * particles.y[i]) < FOUNTAIN_R2 &&
+                particles.z[i] < (FOUNTAIN_HEIGHT + PARTICLE_SIZE / 2))
+            {
+                particles.vz[i] = -FRICTION * particles.vz[i];
+                particles.z[i]  = FOUNTAIN_HEIGHT + PARTICLE_SIZE / 2 +
+                                  FRICTION * (FOUNTAIN_HEIGHT +
+                                  PARTICLE_SIZE / 2 - particles.z[i]);
+            }
+
+            // Particles should bounce on the floor (with friction)
+            else if (particles.z[i] < PARTICLE_SIZE / 2)
+            {
+                particles.vz[i] = -FRICTION * particles.vz[i];
+                particles.z[i]  = PARTICLE_SIZE / 2 +
+                                  FRICTION * (PARTICLE_SIZE / 2 - particles.z[i]);
+            }
         }
+    }
+}
+
 
-        // Particles should bounce on the floor (with friction)
-        else if (p->z < PARTICLE_SIZE / 2)
+//========================================================================
+// Update particles [begin, end), 8 at a time (begin and end multiples of 8)
+// Same physics as update_particles, the branches become masks: every lane
+// is integrated and the bounce is blended in where it happened.
+//========================================================================
+
+#ifdef PARTICLES_AVX
+
+__attribute__((target("avx")))
+static void update_particles_avx(int begin, int end, float dt)
+{
+    const __m256 zero         = _mm256_setzero_ps();
+    const __m256 life_step    = _mm256_set1_ps(dt * (1.f / LIFE_SPAN));
+    const __m256 gravity_step = _mm256_set1_ps(GRAVITY * dt);
+    const __m256 delta        = _mm256_set1_ps(dt);
+    const __m256 fountain_r2  = _mm256_set1_ps(FOUNTAIN_R2);
+    const __m256 fountain_top = _mm256_set1_ps(FOUNTAIN_HEIGHT + PARTICLE_SIZE / 2);
+    const __m256 floor_top    = _mm256_set1_ps(PARTICLE_SIZE / 2);
+    const __m256 friction     = _mm256_set1_ps(FRICTION);
+    int i;
+
+    for (i = begin;  i < end;  i += 8)
+    {
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(particles.life + i), life_step);
+        __m256 vz   = _mm256_sub_ps(_mm256_loadu_ps(particles.vz + i), gravity_step);
+        __m256 x    = _mm256_add_ps(_mm256_loadu_ps(particles.x + i),
+                                    _mm256_mul_ps(_mm256_loadu_ps(particles.vx + i), delta));
+        __m256 y    = _mm256_add_ps(_mm256_loadu_ps(particles.y + i),
+                                    _mm256_mul_ps(_mm256_loadu_ps(particles.vy + i), delta));
+        __m256 z    = _mm256_add_ps(_mm256_loadu_ps(particles.z + i), _mm256_mul_ps(vz, delta));
+        __m256 r2, on_fountain, surface, hit;
+
+        // Inside the fountain radius and below its top -> bounce on the
+        // fountain, otherwise on the floor, only when falling
+        r2 = _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+        on_fountain = _mm256_and_ps(_mm256_cmp_ps(r2, fountain_r2, _CMP_LT_OQ),
+                                    _mm256_cmp_ps(z, fountain_top, _CMP_LT_OQ));
+        surface = _mm256_blendv_ps(floor_top, fountain_top, on_fountain);
+        hit = _mm256_and_ps(_mm256_cmp_ps(vz, zero, _CMP_LT_OQ),
+                            _mm256_cmp_ps(z, surface, _CMP_LT_OQ));
+
+        vz = _mm256_blendv_ps(vz, _mm256_mul_ps(_mm256_sub_ps(zero, friction), vz), hit);
+        z  = _mm256_blendv_ps(z, _mm256_add_ps(surface, _mm256_mul_ps(friction, _mm256_sub_ps(surface, z))), hit);
+
+        _mm256_storeu_ps(particles.life + i, life);
+        _mm256_storeu_ps(particles.vz + i, vz);
+        _mm256_storeu_ps(particles.x + i, x);
+        _mm256_storeu_ps(particles.y + i, y);
+        _mm256_storeu_ps(particles.z + i, z);
+
+        if (_mm256_movemask_ps(_mm256_cmp_ps(life, zero, _CMP_LE_OQ)))
+            dead_blocks[dead_block_count++] = i / 8;
+    }
+}
+
+#endif // PARTICLES_AVX
+
+
+//========================================================================
+// Remove the particles that died during the last step
+//========================================================================
+
+static void remove_dead_particles(void)
+{
+    int n, i, first;
+
+    // Highest block first, and from the top of each block down: everything
+    // above the hole has been checked already and is alive, so the particle
+    // moved in from the end never needs another look
+    for (n = dead_block_count - 1;  n >= 0;  n--)
+    {
+        first = dead_blocks[n] * 8;
+        for (i = first + 7;  i >= first;  i--)
         {
-            p->vz = -FRICTION * p->vz;
-            p->z  = PARTICLE_SIZE / 2 +
-                    FRICTION * (PARTICLE_SIZE / 2 - p->z);
+            if (i < particles.count && particles.life[i] <= 0.f)
+                move_particle(--particles.count, i);
         }
     }
+
+    dead_block_count = 0;
 }
 
 
@@ -344,34 +580,40 @@ static void update_particle(PARTICLE *p, float dt)
 
 static void particle_engine(double t, float dt)
 {
-    int i;
-    float dt2;
+    int i, births, first, spawned;
+    float dt2, age;
 
-    // Update particles (iterated several times per frame if dt is too large)
+    // Update particles (split in several steps if dt is too large)
     while (dt > 0.f)
     {
         // Calculate delta time for this iteration
-        dt2 = dt < MIN_DELTA_T ? dt : MIN_DELTA_T;
+        dt2 = dt < MAX_DELTA_T ? dt : MAX_DELTA_T;
 
-        for (i = 0;  i < MAX_PARTICLES;  i++)
-            update_particle(&particles[i], dt2);
+        dead_block_count = 0;
+#ifdef PARTICLES_AVX
+        if (use_avx)
+            update_particles_avx(0, (particles.count + 7) & ~7, dt2);
+        else
+#endif
+            update_particles(0, particles.count, dt2);
+        remove_dead_particles();
 
         min_age += dt2;
 
-        // Should we create any new particle(s)?
-        while (min_age >= BIRTH_INTERVAL)
+        // Should we create any new particle(s)? All the births of this step
+        // are spawned as one batch
+        births = (int) (min_age / birth_interval);
+        if (births > 0)
         {
-            min_age -= BIRTH_INTERVAL;
+            min_age -= (float) births * birth_interval;
+            spawned = spawn_particles(births, &first);
 
-            // Find a dead particle to replace with a new one
-            for (i = 0;  i < MAX_PARTICLES;  i++)
+            // Oldest first, each newborn has lived for [age] seconds already
+            for (i = 0;  i < spawned;  i++)
             {
-                if (!particles[i].active)
-                {
-                    init_particle(&particles[i], t + min_age);
-                    update_particle(&particles[i], min_age);
-                    break;
-                }
+                age = min_age + (float) (births - 1 - i) * birth_interval;
+                init_particle(first + i, t + age);
+                update_particles(first + i, first + i + 1, age);
             }
         }
 
@@ -380,6 +622,94 @@ static void particle_engine(double t, float dt)
 }
 
 
+//========================================================================
+// Particle snapshots
+//========================================================================
+
+static void alloc_snapshots(int count)
+{
+    int i;
+
+    for (i = 0;  i < 3;  i++)
+    {
+        snapshots.buffers[i].x = calloc(count, sizeof(float));
+        snapshots.buffers[i].y = calloc(count, sizeof(float));
+        snapshots.buffers[i].z = calloc(count, sizeof(float));
+        snapshots.buffers[i].rgba = calloc(count, sizeof(GLuint));
+        snapshots.buffers[i].count = 0;
+    }
+
+    snapshots.back = 0;
+    snapshots.middle = 1;
+    snapshots.front = 2;
+}
+
+static void free_snapshots(void)
+{
+    int i;
+
+    for (i = 0;  i < 3;  i++)
+    {
+        free(snapshots.buffers[i].x);
+        free(snapshots.buffers[i].y);
+        free(snapshots.buffers[i].z);
+        free(snapshots.buffers[i].rgba);
+    }
+}
+
+// Physics thread: copy the particles into the back snapshot and make it the
+// middle one. The snapshot given back is the previous middle one, which the
+// draw loop is not using (it only ever reads the front one), drawn or not
+static void publish_snapshot(void)
+{
+    SNAPSHOT* snapshot = snapshots.buffers + snapshots.back;
+    float alpha;
+    GLuint rgba;
+    int i;
+
+    memcpy(snapshot->x, particles.x, particles.count * sizeof(float));
+    memcpy(snapshot->y, particles.y, particles.count * sizeof(float));
+    memcpy(snapshot->z, particles.z, particles.count * sizeof(float));
+
+    for (i = 0;  i < particles.count;  i++)
+    {
+        // Calculate particle intensity (we set it to max during 75%
+        // of its life, then it fades out)
+        alpha =  4.f * particles.life[i];
+        if (alpha > 1.f)
+            alpha = 1.f;
+
+        // Convert color from float to 8-bit (store it in a 32-bit
+        // integer using endian independent type casting)
+        ((GLubyte*) &rgba)[0] = (GLubyte)(particles.r[i] * 255.f);
+        ((GLubyte*) &rgba)[1] = (GLubyte)(particles.g[i] * 255.f);
+        ((GLubyte*) &rgba)[2] = (GLubyte)(particles.b[i] * 255.f);
+        ((GLubyte*) &rgba)[3] = (GLubyte)(alpha * 255.f);
+        snapshot->rgba[i] = rgba;
+    }
+
+    snapshot->count = particles.count;
+    memcpy(snapshot->glow_pos, glow_pos, sizeof(glow_pos));
+    memcpy(snapshot->glow_color, glow_color, sizeof(glow_color));
+
+    snapshots.back = ATOMIC_EXCHANGE(&snapshots.middle, snapshots.back | SNAPSHOT_FRESH);
+    if (snapshots.back & SNAPSHOT_FRESH)
+        handoff_stats.dropped++;
+    snapshots.back &= SNAPSHOT_INDEX;
+}
+
+// Draw loop: take the middle snapshot if it's newer than the front one,
+// returns 0 when the physics thread hasn't published anything since
+static int acquire_snapshot(void)
+{
+    if (!(ATOMIC_LOAD(&snapshots.middle) & SNAPSHOT_FRESH))
+        return 0;
+
+    snapshots.front = ATOMIC_EXCHANGE(&snapshots.middle, snapshots.front) & SNAPSHOT_INDEX;
+    return 1;
+}
+
+
 //========================================================================
 // Draw all active particles. We use OpenGL 1.1 vertex
 // arrays for this in order to accelerate the drawing.
@@ -390,16 +720,15 @@ static void particle_engine(double t, float dt)
                             // the L1 data cache on most CPUs)
 #define PARTICLE_VERTS  4   // Number of vertices per particle
 
-static void draw_particles(GLFWwindow* window, double t, float dt)
+static void draw_particles(const SNAPSHOT* snapshot)
 {
     int i, particle_count;
     Vertex vertex_array[BATCH_PARTICLES * PARTICLE_VERTS];
     Vertex* vptr;
-    float alpha;
+    float x, y, z;
     GLuint rgba;
     Vec3 quad_lower_left, quad_lower_right;
     GLfloat mat[16];
-    PARTICLE* pptr;
 
     // Here comes the real trick with flat single primitive objects (s.c.
     // "billboards"): We must rotate the textured primitive so that it
@@ -450,89 +779,60 @@ static void draw_particles(GLFWwindow* window, double t, float dt)
     // Most OpenGL cards / drivers are optimized for this format.
     glInterleavedArrays(GL_T2F_C4UB_V3F, 0, vertex_array);
 
-    // Wait for particle physics thread to be done
-    mtx_lock(&thread_sync.particles_lock);
-    while (!glfwWindowShouldClose(window) &&
-            thread_sync.p_frame <= thread_sync.d_frame)
-    {
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_nsec += 100000000;
-        cnd_timedwait(&thread_sync.p_done, &thread_sync.particles_lock, &ts);
-    }
-
-    // Store the frame time and delta time for the physics thread
-    thread_sync.t = t;
-    thread_sync.dt = dt;
-
-    // Update frame counter
-    thread_sync.d_frame++;
-
-    // Loop through all particles and build vertex arrays.
+    // Loop through all particles of the snapshot and build vertex arrays.
+    // The physics thread keeps running meanwhile, it never writes to the
+    // snapshot we're reading.
     particle_count = 0;
     vptr = vertex_array;
-    pptr = particles;
 
-    for (i = 0;  i < MAX_PARTICLES;  i++)
+    for (i = 0;  i < snapshot->count;  i++)
     {
-        if (pptr->active)
-        {
-            // Calculate particle intensity (we set it to max during 75%
-            // of its life, then it fades out)
-            alpha =  4.f * pptr->life;
-            if (alpha > 1.f)
-                alpha = 1.f;
-
-            // Convert color from float to 8-bit (store it in a 32-bit
-            // integer using endian independent type casting)
-            ((GLubyte*) &rgba)[0] = (GLubyte)(pptr->r * 255.f);
-            ((GLubyte*) &rgba)[1] = (GLubyte)(pptr->g * 255.f);
-            ((GLubyte*) &rgba)[2] = (GLubyte)(pptr->b * 255.f);
-            ((GLubyte*) &rgba)[3] = (GLubyte)(alpha * 255.f);
-
-            // 3) Translate the quad to the correct position in modelview
-            // space and store its parameters in vertex arrays (we also
-            // store texture coord and color information for each vertex).
-
-            // Lower left corner
-            vptr->s    = 0.f;
-            vptr->t    = 0.f;
-            vptr->rgba = rgba;
-            vptr->x    = pptr->x + quad_lower_left.x;
-            vptr->y    = pptr->y + quad_lower_left.y;
-            vptr->z    = pptr->z + quad_lower_left.z;
-            vptr ++;
-
-            // Lower right corner
-            vptr->s    = 1.f;
-            vptr->t    = 0.f;
-            vptr->rgba = rgba;
-            vptr->x    = pptr->x + quad_lower_right.x;
-            vptr->y    = pptr->y + quad_lower_right.y;
-            vptr->z    = pptr->z + quad_lower_right.z;
-            vptr ++;
-
-            // Upper right corner
-            vptr->s    = 1.f;
-            vptr->t    = 1.f;
-            vptr->rgba = rgba;
-            vptr->x    = pptr->x - quad_lower_left.x;
-            vptr->y    = pptr->y - quad_lower_left.y;
-            vptr->z    = pptr->z - quad_lower_left.z;
-            vptr ++;
-
-            // Upper left corner
-            vptr->s    = 0.f;
-            vptr->t    = 1.f;
-            vptr->rgba = rgba;
-            vptr->x    = pptr->x - quad_lower_right.x;
-            vptr->y    = pptr->y - quad_lower_right.y;
-            vptr->z    = pptr->z - quad_lower_right.z;
-            vptr ++;
-
-            // Increase count of drawable particles
-            particle_count ++;
-        }
+        // 3) Translate the quad to the correct position in modelview
+        // space and store its parameters in vertex arrays (we also
+        // store texture coord and color information for each vertex).
+        rgba = snapshot->rgba[i];
+        x = snapshot->x[i];
+        y = snapshot->y[i];
+        z = snapshot->z[i];
+
+        // Lower left corner
+        vptr->s    = 0.f;
+        vptr->t    = 0.f;
+        vptr->rgba = rgba;
+        vptr->x    = x + quad_lower_left.x;
+        vptr->y    = y + quad_lower_left.y;
+        vptr->z    = z + quad_lower_left.z;
+        vptr ++;
+
+        // Lower right corner
+        vptr->s    = 1.f;
+        vptr->t    = 0.f;
+        vptr->rgba = rgba;
+        vptr->x    = x + quad_lower_right.x;
+        vptr->y    = y + quad_lower_right.y;
+        vptr->z    = z + quad_lower_right.z;
+        vptr ++;
+
+        // Upper right corner
+        vptr->s    = 1.f;
+        vptr->t    = 1.f;
+        vptr->rgba = rgba;
+        vptr->x    = x - quad_lower_left.x;
+        vptr->y    = y - quad_lower_left.y;
+        vptr->z    = z - quad_lower_left.z;
+        vptr ++;
+
+        // Upper left corner
+        vptr->s    = 0.f;
+        vptr->t    = 1.f;
+        vptr->rgba = rgba;
+        vptr->x    = x - quad_lower_right.x;
+        vptr->y    = y - quad_lower_right.y;
+        vptr->z    = z - quad_lower_right.z;
+        vptr ++;
+
+        // Increase count of drawable particles
+        particle_count ++;
 
         // If we have filled up one batch of particles, draw it as a set
         // of quads using glDrawArrays.
@@ -545,15 +845,8 @@ static void draw_particles(GLFWwindow* window, double t, float dt)
             particle_count = 0;
             vptr = vertex_array;
         }
-
-        // Next particle
-        pptr++;
     }
 
-    // We are done with the particle data
-    mtx_unlock(&thread_sync.particles_lock);
-    cnd_signal(&thread_sync.d_done);
-
     // Draw final batch of particles (if any)
     glDrawArrays(GL_QUADS, 0, PARTICLE_VERTS * particle_count);
 
@@ -570,6 +863,358 @@ static void draw_particles(GLFWwindow* window, double t, float dt)
 }
 
 
+//========================================================================
+// GPU simulation
+// The particle state lives in two buffers on the GPU, each step runs every
+// particle through a vertex shader reading one buffer and captures the
+// result into the other with transform feedback (rasterization off). The
+// newest buffer is then drawn as point sprites, so apart from a few
+// uniforms nothing goes from the CPU to the GPU per frame.
+//
+// Particle i is born at i * birth_interval and again every LIFE_SPAN, the
+// shader finds births from the time alone and draws the random start
+// velocity from a hash of the particle index and its life cycle.
+//========================================================================
+
+// Interleaved particle state, also the transform feedback output layout
+typedef struct
+{
+    GLfloat x, y, z, life;
+    GLfloat vx, vy, vz;
+    GLfloat r, g, b;
+} GPU_PARTICLE;
+
+static struct {
+    int       supported;
+    GLuint    buffers[2];
+    GLuint    vertex_arrays[2];
+    int       current;          // Buffer holding the latest state
+    GLuint    update_program;
+    GLuint    draw_program;
+    GLint     t_old_location;
+    GLint     t_location;
+    GLint     birth_interval_location;
+    GLint     point_scale_location;
+    double    start;            // Simulation time 0 (s, GLFW time)
+    float     t_old;            // End of the last step (s, simulation time)
+} gpu;
+
+#define STRINGIFY(x) STRINGIFY2(x)
+#define STRINGIFY2(x) #x
+
+static const char* gpu_update_source =
+    "#version 130\n"
+    "in vec4 position_life;\n"
+    "in vec3 velocity;\n"
+    "in vec3 color;\n"
+    "out vec4 out_position_life;\n"
+    "out vec3 out_velocity;\n"
+    "out vec3 out_color;\n"
+    "uniform float t_old;\n"
+    "uniform float t;\n"
+    "uniform float birth_interval;\n"
+    "\n"
+    "const float LIFE_SPAN = " STRINGIFY(LIFE_SPAN) ";\n"
+    "const float PARTICLE_SIZE = " STRINGIFY(PARTICLE_SIZE) ";\n"
+    "const float GRAVITY = " STRINGIFY(GRAVITY) ";\n"
+    "const float VELOCITY = " STRINGIFY(VELOCITY) ";\n"
+    "const float FRICTION = " STRINGIFY(FRICTION) ";\n"
+    "const float FOUNTAIN_HEIGHT = " STRINGIFY(FOUNTAIN_HEIGHT) ";\n"
+    "const float FOUNTAIN_RADIUS = " STRINGIFY(FOUNTAIN_RADIUS) ";\n"
+    "\n"
+    "float random(uint x)\n"
+    "{\n"
+    "    x ^= x >> 16; x *= 0x7feb352du; x ^= x >> 15; x *= 0x846ca68bu; x ^= x >> 16;\n"
+    "    return float(x >> 8) / 16777216.0;\n"
+    "}\n"
+    "\n"
+    "void main(void)\n"
+    "{\n"
+    "    vec3 p = position_life.xyz;\n"
+    "    vec3 v = velocity;\n"
+    "    vec3 c = color;\n"
+    "    float birth = float(gl_VertexID) * birth_interval;\n"
+    "    float life = 0.0;\n"
+    "    float dt = t - t_old;\n"
+    "\n"
+    "    if (t >= birth)\n"
+    "    {\n"
+    "        // Born (again) during this step?\n"
+    "        float cycle = floor((t - birth) / LIFE_SPAN);\n"
+    "        float born_at = birth + cycle * LIFE_SPAN;\n"
+    "        if (t_old < birth || floor((t_old - birth) / LIFE_SPAN) != cycle)\n"
+    "        {\n"
+    "            uint seed = uint(gl_VertexID) * 2u + uint(cycle) * 0x9e3779b9u;\n"
+    "            float angle = 6.2831853 * random(seed + 1u);\n"
+    "            float speed = VELOCITY * (0.8 + 0.1 * (sin(0.5 * born_at) + sin(1.31 * born_at)));\n"
+    "            p = vec3(0.0, 0.0, FOUNTAIN_HEIGHT);\n"
+    "            v = speed * vec3(0.4 * cos(angle), 0.4 * sin(angle), 0.7 + 0.3 * random(seed));\n"
+    "            c = vec3(0.7 + 0.3 * sin(0.34 * born_at + 0.1),\n"
+    "                     0.6 + 0.4 * sin(0.63 * born_at + 1.1),\n"
+    "                     0.6 + 0.4 * sin(0.91 * born_at + 2.1));\n"
+    "            dt = t - born_at;\n"
+    "        }\n"
+    "        life = 1.0 - (t - born_at) / LIFE_SPAN;\n"
+    "\n"
+    "        // Same physics as update_particles\n"
+    "        v.z -= GRAVITY * dt;\n"
+    "        p += v * dt;\n"
+    "        if (v.z < 0.0)\n"
+    "        {\n"
+    "            float r = FOUNTAIN_RADIUS + PARTICLE_SIZE / 2.0;\n"
+    "            float top = FOUNTAIN_HEIGHT + PARTICLE_SIZE / 2.0;\n"
+    "            float surface = dot(p.xy, p.xy) < r * r && p.z < top ? top : PARTICLE_SIZE / 2.0;\n"
+    "            if (p.z < surface)\n"
+    "            {\n"
+    "                v.z = -FRICTION * v.z;\n"
+    "                p.z = surface + FRICTION * (surface - p.z);\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    out_position_life = vec4(p, life);\n"
+    "    out_velocity = v;\n"
+    "    out_color = c;\n"
+    "}\n";
+
+static const char* gpu_draw_vertex_source =
+    "#version 130\n"
+    "in vec4 position_life;\n"
+    "in vec3 color;\n"
+    "out vec4 particle_color;\n"
+    "uniform float point_scale;\n"
+    "\n"
+    "void main(void)\n"
+    "{\n"
+    "    vec4 eye = gl_ModelViewMatrix * vec4(position_life.xyz, 1.0);\n"
+    "    gl_Position = gl_ProjectionMatrix * eye;\n"
+    "    gl_PointSize = point_scale / max(-eye.z, 0.1);\n"
+    "    // Full intensity during 75% of its life, then it fades out\n"
+    "    particle_color = vec4(color, clamp(4.0 * position_life.w, 0.0, 1.0));\n"
+    "}\n";
+
+static const char* gpu_draw_fragment_source =
+    "#version 130\n"
+    "in vec4 particle_color;\n"
+    "uniform sampler2D particle_texture;\n"
+    "\n"
+    "void main(void)\n"
+    "{\n"
+    "    gl_FragColor = vec4(particle_color.rgb * texture(particle_texture, gl_PointCoord).r,\n"
+    "                        particle_color.a);\n"
+    "}\n";
+
+static GLuint compile_shader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    GLint status;
+    char log[1024];
+
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status)
+    {
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "Particle shader compilation failed:\n%s\n", log);
+    }
+
+    return shader;
+}
+
+// Links the shaders, the transform feedback varyings (if any) have to be
+// known before linking
+static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader,
+                           const char** varyings, int varying_count)
+{
+    GLuint program = glCreateProgram();
+    GLint status;
+    char log[1024];
+
+    glAttachShader(program, vertex_shader);
+    if (fragment_shader)
+        glAttachShader(program, fragment_shader);
+
+    glBindAttribLocation(program, 0, "position_life");
+    glBindAttribLocation(program, 1, "velocity");
+    glBindAttribLocation(program, 2, "color");
+    if (varying_count)
+        glTransformFeedbackVaryings(program, varying_count, varyings, GL_INTERLEAVED_ATTRIBS);
+
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status)
+    {
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "Particle program linking failed:\n%s\n", log);
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+    glDeleteShader(vertex_shader);
+    if (fragment_shader)
+        glDeleteShader(fragment_shader);
+    return program;
+}
+
+static void init_gpu_particles(void)
+{
+    static const char* varyings[] = { "out_position_life", "out_velocity", "out_color" };
+    int i;
+
+    // Transform feedback and GLSL 1.30 need GL 3.0
+    if (!GLAD_GL_VERSION_3_0)
+        return;
+
+    gpu.update_program = link_program(compile_shader(GL_VERTEX_SHADER, gpu_update_source),
+                                      0, varyings, 3);
+    gpu.draw_program = link_program(compile_shader(GL_VERTEX_SHADER, gpu_draw_vertex_source),
+                                    compile_shader(GL_FRAGMENT_SHADER, gpu_draw_fragment_source),
+                                    NULL, 0);
+    if (!gpu.update_program || !gpu.draw_program)
+        return;
+
+    gpu.t_old_location = glGetUniformLocation(gpu.update_program, "t_old");
+    gpu.t_location = glGetUniformLocation(gpu.update_program, "t");
+    gpu.birth_interval_location = glGetUniformLocation(gpu.update_program, "birth_interval");
+    gpu.point_scale_location = glGetUniformLocation(gpu.draw_program, "point_scale");
+
+    glGenBuffers(2, gpu.buffers);
+    glGenVertexArrays(2, gpu.vertex_arrays);
+    for (i = 0;  i < 2;  i++)
+    {
+        glBindVertexArray(gpu.vertex_arrays[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, gpu.buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, max_particles * sizeof(GPU_PARTICLE), NULL, GL_DYNAMIC_COPY);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GPU_PARTICLE), (void*) 0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GPU_PARTICLE), (void*) (4 * sizeof(GLfloat)));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(GPU_PARTICLE), (void*) (7 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+    }
+
+    // Back to the default vertex array for the client side arrays
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gpu.supported = 1;
+}
+
+// Start over with no particle born yet, the only upload of the GPU path
+static void reset_gpu_particles(void)
+{
+    GPU_PARTICLE* zero = calloc(max_particles, sizeof(GPU_PARTICLE));
+
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.buffers[0]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, max_particles * sizeof(GPU_PARTICLE), zero);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    free(zero);
+
+    gpu.current = 0;
+    gpu.start = glfwGetTime();
+    gpu.t_old = 0.f;
+}
+
+// Steps of at most MAX_DELTA_T up to time t (GLFW time)
+static void update_gpu_particles(double t)
+{
+    float end = (float) (t - gpu.start), step;
+
+    glUseProgram(gpu.update_program);
+    glUniform1f(gpu.birth_interval_location, birth_interval);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    while (gpu.t_old < end)
+    {
+        step = end - gpu.t_old < MAX_DELTA_T ? end : gpu.t_old + MAX_DELTA_T;
+        glUniform1f(gpu.t_old_location, gpu.t_old);
+        glUniform1f(gpu.t_location, step);
+
+        glBindVertexArray(gpu.vertex_arrays[gpu.current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gpu.buffers[!gpu.current]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, max_particles);
+        glEndTransformFeedback();
+
+        gpu.current = !gpu.current;
+        gpu.t_old = step;
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+// Fountain lighting from the particle born last, computed like the shader does
+static void gpu_glow(float* position, float* color)
+{
+    float t = gpu.t_old;
+
+    position[0] = 0.4f * (float) sin(1.34 * t);
+    position[1] = 0.4f * (float) sin(3.11 * t);
+    position[2] = FOUNTAIN_HEIGHT + 1.f;
+    position[3] = 1.f;
+    color[0] = 0.7f + 0.3f * (float) sin(0.34 * t + 0.1);
+    color[1] = 0.6f + 0.4f * (float) sin(0.63 * t + 1.1);
+    color[2] = 0.6f + 0.4f * (float) sin(0.91 * t + 2.1);
+    color[3] = 1.f;
+}
+
+static void draw_gpu_particles(const mat4x4 projection)
+{
+    // Size in pixels of PARTICLE_SIZE at distance 1, the shader divides by the depth
+    float point_scale = PARTICLE_SIZE * projection[1][1] * viewport_height * 0.5f;
+
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glEnable(GL_POINT_SPRITE);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glBindTexture(GL_TEXTURE_2D, particle_tex_id);
+
+    glUseProgram(gpu.draw_program);
+    glUniform1f(gpu.point_scale_location, point_scale);
+    glBindVertexArray(gpu.vertex_arrays[gpu.current]);
+    glDrawArrays(GL_POINTS, 0, max_particles);
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glDisable(GL_POINT_SPRITE);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+}
+
+static void free_gpu_particles(void)
+{
+    if (!gpu.supported)
+        return;
+
+    glDeleteVertexArrays(2, gpu.vertex_arrays);
+    glDeleteBuffers(2, gpu.buffers);
+    glDeleteProgram(gpu.update_program);
+    glDeleteProgram(gpu.draw_program);
+    gpu.supported = 0;
+}
+
+// Switch between the CPU and the GPU simulation (main thread only)
+static void set_simulation_mode(int mode)
+{
+    if (mode == SIMULATION_GPU && !gpu.supported)
+    {
+        fprintf(stderr, "GPU simulation needs OpenGL 3.0, staying on the CPU\n");
+        return;
+    }
+
+    if (mode == SIMULATION_GPU)
+        reset_gpu_particles();
+
+    ATOMIC_EXCHANGE(&simulation_mode, mode);
+    printf("Simulating particles on the %s\n", mode == SIMULATION_GPU ? "GPU" : "CPU");
+}
+
+
 //========================================================================
 // Fountain geometry specification
 //========================================================================
@@ -742,7 +1387,7 @@ static void draw_floor(void)
 // Position and configure light sources
 //========================================================================
 
-static void setup_lights(void)
+static void setup_lights(const float* light_pos, const float* light_color)
 {
     float l1pos[4], l1amb[4], l1dif[4], l1spec[4];
     float l2pos[4], l2amb[4], l2dif[4], l2spec[4];
@@ -767,9 +1412,9 @@ static void setup_lights(void)
     glLightfv(GL_LIGHT2, GL_AMBIENT, l2amb);
     glLightfv(GL_LIGHT2, GL_DIFFUSE, l2dif);
     glLightfv(GL_LIGHT2, GL_SPECULAR, l2spec);
-    glLightfv(GL_LIGHT3, GL_POSITION, glow_pos);
-    glLightfv(GL_LIGHT3, GL_DIFFUSE, glow_color);
-    glLightfv(GL_LIGHT3, GL_SPECULAR, glow_color);
+    glLightfv(GL_LIGHT3, GL_POSITION, light_pos);
+    glLightfv(GL_LIGHT3, GL_DIFFUSE, light_color);
+    glLightfv(GL_LIGHT3, GL_SPECULAR, light_color);
 
     glEnable(GL_LIGHT1);
     glEnable(GL_LIGHT2);
@@ -787,10 +1432,34 @@ static void draw_scene(GLFWwindow* window, double t)
     static double t_old = 0.0;
     float dt;
     mat4x4 projection;
+    const SNAPSHOT* snapshot = NULL;
+    float light_pos[4], light_color[4];
+    int mode = simulation_mode;
 
     // Calculate frame-to-frame delta time
     dt = (float) (t - t_old);
     t_old = t;
+    mode_stats[mode].frames++;
+    mode_stats[mode].time += dt;
+
+    if (mode == SIMULATION_GPU)
+    {
+        update_gpu_particles(t);
+        gpu_glow(light_pos, light_color);
+    }
+    else
+    {
+        // Latest particle frame from the physics thread, without waiting for it
+        handoff_stats.frames++;
+        if (!acquire_snapshot())
+        {
+            handoff_stats.stale_frames++;
+            handoff_stats.draw_stall += dt;
+        }
+        snapshot = snapshots.buffers + snapshots.front;
+        memcpy(light_pos, snapshot->glow_pos, sizeof(light_pos));
+        memcpy(light_color, snapshot->glow_color, sizeof(light_color));
+    }
 
     mat4x4_perspective(projection,
                        65.f * (float) M_PI / 180.f,
@@ -827,7 +1496,7 @@ static void draw_scene(GLFWwindow* window, double t)
     glCullFace(GL_BACK);
     glEnable(GL_CULL_FACE);
 
-    setup_lights();
+    setup_lights(light_pos, light_color);
     glEnable(GL_LIGHTING);
 
     glEnable(GL_FOG);
@@ -847,7 +1516,10 @@ static void draw_scene(GLFWwindow* window, double t)
     glDisable(GL_FOG);
 
     // Particles must be drawn after all solid objects have been drawn
-    draw_particles(window, t, dt);
+    if (mode == SIMULATION_GPU)
+        draw_gpu_particles(projection);
+    else
+        draw_particles(snapshot);
 
     // Z-buffer not needed anymore
     glDisable(GL_DEPTH_TEST);
@@ -862,6 +1534,7 @@ static void resize_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
     aspect_ratio = height ? width / (float) height : 1.f;
+    viewport_height = height;
 }
 
 
@@ -878,6 +1551,10 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
             case GLFW_KEY_ESCAPE:
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
                 break;
+            case GLFW_KEY_G:
+                set_simulation_mode(simulation_mode == SIMULATION_CPU ?
+                                    SIMULATION_GPU : SIMULATION_CPU);
+                break;
             case GLFW_KEY_W:
                 wireframe = !wireframe;
                 glPolygonMode(GL_FRONT_AND_BACK,
@@ -894,39 +1571,154 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 // Thread for updating particle physics
 //========================================================================
 
+// Physics steps per second, independent of the draw loop's frame rate
+#define PHYSICS_RATE 120.0
+
+// Give the CPU away for the given number of seconds, under a millisecond
+// isn't worth a sleep
+static void physics_pause(double seconds)
+{
+    struct timespec ts;
+    long nsec;
+
+    // The Win32 thrd_sleep casts the time left to a DWORD, a wake up time
+    // that has passed by the time it looks wraps around to ~49 days
+    if (seconds < 0.001)
+        return;
+
+    nsec = (long) (seconds * 1e9);
+
+    // thrd_sleep wants the time to wake up at
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += nsec / 1000000000;
+    ts.tv_nsec += nsec % 1000000000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    thrd_sleep(&ts, NULL);
+}
+
 static int physics_thread_main(void* arg)
 {
     GLFWwindow* window = arg;
+    double t, t_old = glfwGetTime(), next = t_old;
 
-    for (;;)
+    while (!glfwWindowShouldClose(window))
     {
-        mtx_lock(&thread_sync.particles_lock);
-
-        // Wait for particle drawing to be done
-        while (!glfwWindowShouldClose(window) &&
-               thread_sync.p_frame > thread_sync.d_frame)
+        // Nothing to do while the GPU simulates, the time spent idle
+        // is skipped when the CPU takes over again
+        if (ATOMIC_LOAD(&simulation_mode) != SIMULATION_CPU)
         {
-            struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec += 100000000;
-            cnd_timedwait(&thread_sync.d_done, &thread_sync.particles_lock, &ts);
+            physics_pause(0.01);
+            t_old = next = glfwGetTime();
+            continue;
         }
 
-        if (glfwWindowShouldClose(window))
-            break;
+        // Update particles, on the physics thread's own clock
+        t = glfwGetTime();
+        particle_engine(t, (float) (t - t_old));
+        t_old = t;
+
+        // Publish right away, if the draw loop hasn't taken the previous
+        // snapshot yet this one replaces it
+        publish_snapshot();
+        handoff_stats.steps++;
+
+        // Sleep until the next step is due, a step that ran late starts
+        // the schedule over instead of trying to catch up
+        next += 1.0 / PHYSICS_RATE;
+        t = glfwGetTime();
+        if (next > t)
+            physics_pause(next - t);
+        else
+            next = t;
+    }
 
-        // Update particles
-        particle_engine(thread_sync.t, thread_sync.dt);
+    return 0;
+}
 
-        // Update frame counter
-        thread_sync.p_frame++;
 
-        // Unlock mutex and signal drawing thread
-        mtx_unlock(&thread_sync.particles_lock);
-        cnd_signal(&thread_sync.p_done);
-    }
+//========================================================================
+// Spawn benchmark: the old linear search for a dead particle against
+// spawn_particles, with the pool full except for [SPAWN_BATCH] scattered
+// holes. Both paths include init_particle.
+//========================================================================
 
-    return 0;
+#define SPAWN_BATCH  1000
+#define SPAWN_ROUNDS 5
+
+static void benchmark_spawn(void)
+{
+    static const int sizes[] = { 1000, 10000, 100000, 1000000 };
+    int s, round, k, i, first, size, stride;
+    double start, scan_time, pool_time;
+    char* active;
+
+    printf("%d spawns into a full pool with scattered holes, %d rounds\n",
+           SPAWN_BATCH, SPAWN_ROUNDS);
+    printf("pool size   linear search (Mspawns/s)   spawn_particles (Mspawns/s)\n");
+
+    for (s = 0;  s < (int) (sizeof(sizes) / sizeof(sizes[0]));  s++)
+    {
+        size = sizes[s];
+        stride = size / SPAWN_BATCH;
+        max_particles = size;
+        alloc_particles(size);
+        active = malloc(size);
+        scan_time = pool_time = 0.0;
+
+        for (round = 0;  round < SPAWN_ROUNDS;  round++)
+        {
+            // Old allocator: every birth searches from the start of the pool
+            memset(active, 1, size);
+            for (k = 0;  k < SPAWN_BATCH;  k++)
+                active[k * stride + rand() % stride] = 0;
+
+            start = glfwGetTime();
+            for (k = 0;  k < SPAWN_BATCH;  k++)
+            {
+                for (i = 0;  i < size;  i++)
+                {
+                    if (!active[i])
+                    {
+                        init_particle(i, start);
+                        active[i] = 1;
+                        break;
+                    }
+                }
+            }
+            scan_time += glfwGetTime() - start;
+
+            // Pool: free the same number of scattered particles, then spawn
+            // them back as one batch
+            particles.count = size;
+            for (i = 0;  i < size;  i++)
+                particles.life[i] = 1.f;
+            for (k = 0;  k < SPAWN_BATCH;  k++)
+            {
+                i = k * stride + rand() % stride;
+                particles.life[i] = 0.f;
+                if (dead_block_count == 0 || dead_blocks[dead_block_count - 1] != i / 8)
+                    dead_blocks[dead_block_count++] = i / 8;
+            }
+
+            start = glfwGetTime();
+            remove_dead_particles();
+            k = spawn_particles(SPAWN_BATCH, &first);
+            for (i = 0;  i < k;  i++)
+                init_particle(first + i, start);
+            pool_time += glfwGetTime() - start;
+        }
+
+        printf("%9d   %25.3f   %27.3f\n", size,
+               SPAWN_BATCH * SPAWN_ROUNDS / scan_time / 1e6,
+               SPAWN_BATCH * SPAWN_ROUNDS / pool_time / 1e6);
+
+        free(active);
+        free_particles();
+    }
 }
 
 
@@ -936,7 +1728,7 @@ static int physics_thread_main(void* arg)
 
 int main(int argc, char** argv)
 {
-    int ch, width, height;
+    int ch, width, height, start_on_gpu = 0;
     thrd_t physics_thread = 0;
     GLFWwindow* window;
     GLFWmonitor* monitor = NULL;
@@ -947,19 +1739,36 @@ int main(int argc, char** argv)
         exit(EXIT_FAILURE);
     }
 
-    while ((ch = getopt(argc, argv, "fh")) != -1)
+    while ((ch = getopt(argc, argv, "bfghn:")) != -1)
     {
         switch (ch)
         {
+            case 'b':
+                benchmark_spawn();
+                glfwTerminate();
+                exit(EXIT_SUCCESS);
             case 'f':
                 monitor = glfwGetPrimaryMonitor();
                 break;
+            case 'g':
+                start_on_gpu = 1;
+                break;
             case 'h':
                 usage();
                 exit(EXIT_SUCCESS);
+            case 'n':
+                max_particles = atoi(optarg);
+                if (max_particles < 1)
+                    max_particles = 1;
+                break;
         }
     }
 
+    alloc_particles(max_particles);
+#ifdef PARTICLES_AVX
+    use_avx = __builtin_cpu_supports("avx");
+#endif
+
     if (monitor)
     {
         const GLFWvidmode* mode = glfwGetVideoMode(monitor);
@@ -1032,15 +1841,15 @@ int main(int argc, char** argv)
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     wireframe = 0;
 
-    // Set initial times
-    thread_sync.t  = 0.0;
-    thread_sync.dt = 0.001f;
-    thread_sync.p_frame = 0;
-    thread_sync.d_frame = 0;
+    // Set initial time, before the physics thread starts reading it
+    glfwSetTime(0.0);
+
+    init_gpu_particles();
+    if (start_on_gpu)
+        set_simulation_mode(SIMULATION_GPU);
 
-    mtx_init(&thread_sync.particles_lock, mtx_timed);
-    cnd_init(&thread_sync.p_done);
-    cnd_init(&thread_sync.d_done);
+    alloc_snapshots(max_particles);
+    memset(&handoff_stats, 0, sizeof(handoff_stats));
 
     if (thrd_create(&physics_thread, physics_thread_main, window) != thrd_success)
     {
@@ -1048,8 +1857,6 @@ int main(int argc, char** argv)
         exit(EXIT_FAILURE);
     }
 
-    glfwSetTime(0.0);
-
     while (!glfwWindowShouldClose(window))
     {
         draw_scene(window, glfwGetTime());
@@ -1060,6 +1867,25 @@ int main(int argc, char** argv)
 
     thrd_join(physics_thread, NULL);
 
+    printf("Physics: %d steps, %d replaced before they were drawn\n",
+           handoff_stats.steps, handoff_stats.dropped);
+    printf("Draw:    %d frames, %d without a new snapshot (%.3f s stalled)\n",
+           handoff_stats.frames, handoff_stats.stale_frames, handoff_stats.draw_stall);
+
+    for (ch = SIMULATION_CPU;  ch <= SIMULATION_GPU;  ch++)
+    {
+        if (mode_stats[ch].frames)
+        {
+            printf("%s simulation: %d frames, %.3f ms per frame\n",
+                   ch == SIMULATION_GPU ? "GPU" : "CPU", mode_stats[ch].frames,
+                   mode_stats[ch].time * 1000.0 / mode_stats[ch].frames);
+        }
+    }
+
+    free_gpu_particles();
+    free_snapshots();
+    free_particles();
+
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -15,13 +15,29 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include <tinycthread.h>
+#include <getopt.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include <linmath.h>
 
+#if defined(_WIN32)
+ #include <windows.h>
+#else
+ #include <unistd.h>
+#endif
+
+// The row kernels run 8 cells at a time with AVX where the CPU has it,
+// picked at runtime so the binary still runs everywhere
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #include <immintrin.h>
+ #define WAVE_AVX
+#endif
+
 // Maximum delta T to allow for differential calculations
 #define MAX_DELTA_T 0.01
 
@@ -40,16 +56,15 @@ struct Vertex
     GLfloat r, g, b;
 };
 
-#define GRIDW 50
-#define GRIDH 50
-#define VERTEXNUM (GRIDW*GRIDH)
+// Default grid size (change it with -s)
+#define GRID_SIZE 50
 
-#define QUADW (GRIDW - 1)
-#define QUADH (GRIDH - 1)
-#define QUADNUM (QUADW*QUADH)
+int grid_width = GRID_SIZE;
+int grid_height = GRID_SIZE;
+int quad_count;
 
-GLuint quad[4 * QUADNUM];
-struct Vertex vertex[VERTEXNUM];
+GLuint* quad;
+struct Vertex* vertex;
 
 /* The grid will look like this:
  *
@@ -71,14 +86,14 @@ void init_vertices(void)
     int x, y, p;
 
     // Place the vertices in a grid
-    for (y = 0;  y < GRIDH;  y++)
+    for (y = 0;  y < grid_height;  y++)
     {
-        for (x = 0;  x < GRIDW;  x++)
+        for (x = 0;  x < grid_width;  x++)
         {
-            p = y * GRIDW + x;
+            p = y * grid_width + x;
 
-            vertex[p].x = (GLfloat) (x - GRIDW / 2) / (GLfloat) (GRIDW / 2);
-            vertex[p].y = (GLfloat) (y - GRIDH / 2) / (GLfloat) (GRIDH / 2);
+            vertex[p].x = (GLfloat) (x - grid_width / 2) / (GLfloat) (grid_width / 2);
+            vertex[p].y = (GLfloat) (y - grid_height / 2) / (GLfloat) (grid_height / 2);
             vertex[p].z = 0;
 
             if ((x % 4 < 2) ^ (y % 4 < 2))
@@ -86,29 +101,60 @@ void init_vertices(void)
             else
                 vertex[p].r = 1.0;
 
-            vertex[p].g = (GLfloat) y / (GLfloat) GRIDH;
-            vertex[p].b = 1.f - ((GLfloat) x / (GLfloat) GRIDW + (GLfloat) y / (GLfloat) GRIDH) / 2.f;
+            vertex[p].g = (GLfloat) y / (GLfloat) grid_height;
+            vertex[p].b = 1.f - ((GLfloat) x / (GLfloat) grid_width + (GLfloat) y / (GLfloat) grid_height) / 2.f;
         }
     }
 
-    for (y = 0;  y < QUADH;  y++)
+    for (y = 0;  y < grid_height - 1;  y++)
     {
-        for (x = 0;  x < QUADW;  x++)
+        for (x = 0;  x < grid_width - 1;  x++)
         {
-            p = 4 * (y * QUADW + x);
+            p = 4 * (y * (grid_width - 1) + x);
 
-            quad[p + 0] = y       * GRIDW + x;     // Some point
-            quad[p + 1] = y       * GRIDW + x + 1; // Neighbor at the right side
-            quad[p + 2] = (y + 1) * GRIDW + x + 1; // Upper right neighbor
-            quad[p + 3] = (y + 1) * GRIDW + x;     // Upper neighbor
+            quad[p + 0] = y       * grid_width + x;     // Some point
+            quad[p + 1] = y       * grid_width + x + 1; // Neighbor at the right side
+            quad[p + 2] = (y + 1) * grid_width + x + 1; // Upper right neighbor
+            quad[p + 3] = (y + 1) * grid_width + x;     // Upper neighbor
         }
     }
 }
 
+// Simulation state, one row after the other: cell (x, y) is [y * grid_width + x],
+// the same order as the vertices
 double dt;
-double p[GRIDW][GRIDH];
-double vx[GRIDW][GRIDH], vy[GRIDW][GRIDH];
-double ax[GRIDW][GRIDH], ay[GRIDW][GRIDH];
+float time_step;
+float* p;
+float* vx;
+float* vy;
+
+// Set when the CPU supports AVX
+int use_avx;
+
+//========================================================================
+// Allocate the grid
+//========================================================================
+
+void alloc_grid(void)
+{
+    int cells = grid_width * grid_height;
+
+    quad_count = (grid_width - 1) * (grid_height - 1);
+    quad = calloc(4 * quad_count, sizeof(GLuint));
+    vertex = calloc(cells, sizeof(struct Vertex));
+    p = calloc(cells, sizeof(float));
+    vx = calloc(cells, sizeof(float));
+    vy = calloc(cells, sizeof(float));
+}
+
+void free_grid(void)
+{
+    free(quad);
+    free(vertex);
+    free(p);
+    free(vx);
+    free(vy);
+}
 
 //========================================================================
 // Initialize grid
@@ -119,23 +165,23 @@ void init_grid(void)
     int x, y;
     double dx, dy, d;
 
-    for (y = 0; y < GRIDH;  y++)
+    for (y = 0; y < grid_height;  y++)
     {
-        for (x = 0; x < GRIDW;  x++)
+        for (x = 0; x < grid_width;  x++)
         {
-            dx = (double) (x - GRIDW / 2);
-            dy = (double) (y - GRIDH / 2);
+            dx = (double) (x - grid_width / 2);
+            dy = (double) (y - grid_height / 2);
             d = sqrt(dx * dx + dy * dy);
-            if (d < 0.1 * (double) (GRIDW / 2))
+            if (d < 0.1 * (double) (grid_width / 2))
             {
                 d = d * 10.0;
-                p[x][y] = -cos(d * (M_PI / (double)(GRIDW * 4))) * 100.0;
+                p[y * grid_width + x] = (float) (-cos(d * (M_PI / (double)(grid_width * 4))) * 100.0);
             }
             else
-                p[x][y] = 0.0;
+                p[y * grid_width + x] = 0.f;
 
-            vx[x][y] = 0.0;
-            vy[x][y] = 0.0;
+            vx[y * grid_width + x] = 0.f;
+            vy[y * grid_width + x] = 0.f;
         }
     }
 }
@@ -160,7 +206,7 @@ void draw_scene(GLFWwindow* window)
     glRotatef(beta, 1.0, 0.0, 0.0);
     glRotatef(alpha, 0.0, 0.0, 1.0);
 
-    glDrawElements(GL_QUADS, 4 * QUADNUM, GL_UNSIGNED_INT, quad);
+    glDrawElements(GL_QUADS, 4 * quad_count, GL_UNSIGNED_INT, quad);
 
     glfwSwapBuffers(window);
 }
@@ -180,7 +226,7 @@ void init_opengl(void)
 
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_COLOR_ARRAY);
-    glVertexPointer(3, GL_FLOAT, sizeof(struct Vertex), vertex);
+    glVertexPointer(3, GL_FLOAT, sizeof(struct Vertex), &vertex[0].x);
     glColorPointer(3, GL_FLOAT, sizeof(struct Vertex), &vertex[0].r); // Pointer to the first color
 
     glPointSize(2.0);
@@ -191,68 +237,413 @@ void init_opengl(void)
 
 
 //========================================================================
-// Modify the height of each vertex according to the pressure
+// Worker threads
+// The grid is cut in one band of rows per thread, run_bands() hands every
+// band to its thread (band 0 to the calling thread) and returns when all
+// of them are done. Every worker waits on its own condition, the bundled
+// cnd_broadcast only wakes a single thread on POSIX.
 //========================================================================
 
-void adjust_grid(void)
+#define MAX_THREADS 64
+
+typedef void (*BAND_FUNCTION)(int first_row, int last_row);
+
+struct {
+    thrd_t        threads[MAX_THREADS];
+    int           count;        // Threads running bands, including the main thread
+    mtx_t         lock;
+    cnd_t         start[MAX_THREADS]; // Signaled when a job is posted
+    cnd_t         done;         // Signaled when the last worker finished it
+    BAND_FUNCTION function;
+    int           generation;   // Incremented for every job
+    int           pending;      // Workers still running the current job
+    int           quit;
+} pool;
+
+// Rows [first, last) of band [index]
+static void band_rows(int index, int* first, int* last)
 {
-    int pos;
-    int x, y;
+    *first = (int) ((long long) grid_height * index / pool.count);
+    *last = (int) ((long long) grid_height * (index + 1) / pool.count);
+}
 
-    for (y = 0; y < GRIDH;  y++)
+static int worker_main(void* arg)
+{
+    int index = (int) (size_t) arg;
+    int seen = 0, first, last;
+    BAND_FUNCTION function;
+
+    mtx_lock(&pool.lock);
+    for (;;)
     {
-        for (x = 0;  x < GRIDW;  x++)
-        {
-            pos = y * GRIDW + x;
-            vertex[pos].z = (float) (p[x][y] * (1.0 / 50.0));
-        }
+        while (pool.generation == seen && !pool.quit)
+            cnd_wait(&pool.start[index], &pool.lock);
+        if (pool.quit)
+            break;
+
+        seen = pool.generation;
+        function = pool.function;
+        mtx_unlock(&pool.lock);
+
+        band_rows(index, &first, &last);
+        function(first, last);
+
+        mtx_lock(&pool.lock);
+        if (--pool.pending == 0)
+            cnd_signal(&pool.done);
+    }
+    mtx_unlock(&pool.lock);
+
+    return 0;
+}
+
+static int cpu_count(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int) info.dwNumberOfProcessors;
+#else
+    return (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+void start_threads(int count)
+{
+    int i;
+
+    if (count < 1)
+        count = 1;
+    if (count > MAX_THREADS)
+        count = MAX_THREADS;
+
+    mtx_init(&pool.lock, mtx_plain);
+    cnd_init(&pool.done);
+    for (i = 1;  i < count;  i++)
+        cnd_init(&pool.start[i]);
+    pool.count = count;
+    pool.generation = 0;
+    pool.pending = 0;
+    pool.quit = 0;
+
+    for (i = 1;  i < count;  i++)
+        thrd_create(&pool.threads[i], worker_main, (void*) (size_t) i);
+}
+
+void stop_threads(void)
+{
+    int i;
+
+    mtx_lock(&pool.lock);
+    pool.quit = 1;
+    for (i = 1;  i < pool.count;  i++)
+        cnd_signal(&pool.start[i]);
+    mtx_unlock(&pool.lock);
+
+    for (i = 1;  i < pool.count;  i++)
+    {
+        thrd_join(pool.threads[i], NULL);
+        cnd_destroy(&pool.start[i]);
+    }
+
+    mtx_destroy(&pool.lock);
+    cnd_destroy(&pool.done);
+}
+
+static void run_bands(BAND_FUNCTION function)
+{
+    int i, first, last;
+
+    if (pool.count > 1)
+    {
+        mtx_lock(&pool.lock);
+        pool.function = function;
+        pool.pending = pool.count - 1;
+        pool.generation++;
+        for (i = 1;  i < pool.count;  i++)
+            cnd_signal(&pool.start[i]);
+        mtx_unlock(&pool.lock);
+    }
+
+    band_rows(0, &first, &last);
+    function(first, last);
+
+    if (pool.count > 1)
+    {
+        mtx_lock(&pool.lock);
+        while (pool.pending)
+            cnd_wait(&pool.done, &pool.lock);
+        mtx_unlock(&pool.lock);
     }
 }
 
 
+//========================================================================
+// Modify the height of each vertex according to the pressure
+//========================================================================
+
+static void adjust_band(int first_row, int last_row)
+{
+    int pos;
+
+    for (pos = first_row * grid_width;  pos < last_row * grid_width;  pos++)
+        vertex[pos].z = p[pos] * (1.f / 50.f);
+}
+
+void adjust_grid(void)
+{
+    run_bands(adjust_band);
+}
+
+
 //========================================================================
 // Calculate wave propagation
+//
+// One step is: acceleration from the pressure difference to the right /
+// upper neighbor (wrapping around), velocity += acceleration, pressure +=
+// velocity difference to the left / lower neighbor (row and column 0 stay
+// put). Going through the rows upwards, all of it fits in one sweep: when
+// row y is reached its velocities still see the old pressure of rows y and
+// y + 1, and the pressure of row y needs the new velocities of rows y and
+// y - 1, which were just computed. The acceleration is never stored and
+// every cell is read and written once per step.
+//
+// Every thread sweeps its own band of rows. Only the first row of a band
+// has to wait: its pressure needs the band below to be done, and the band
+// below needs its old pressure. Those rows are finished after the sweep.
 //========================================================================
 
+#ifdef WAVE_AVX
+
+// Cells [0, count) of a row, count a multiple of 8, right = row + 1
+__attribute__((target("avx")))
+static void velocity_row_avx(const float* row, const float* up, float* vx_row, float* vy_row, int count)
+{
+    const __m256 step = _mm256_set1_ps(time_step);
+    __m256 center;
+    int x;
+
+    for (x = 0;  x < count;  x += 8)
+    {
+        center = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(vx_row + x, _mm256_add_ps(_mm256_loadu_ps(vx_row + x),
+            _mm256_mul_ps(_mm256_sub_ps(center, _mm256_loadu_ps(row + x + 1)), step)));
+        _mm256_storeu_ps(vy_row + x, _mm256_add_ps(_mm256_loadu_ps(vy_row + x),
+            _mm256_mul_ps(_mm256_sub_ps(center, _mm256_loadu_ps(up + x)), step)));
+    }
+}
+
+// Cells [1, count + 1) of a row, count a multiple of 8
+__attribute__((target("avx")))
+static void pressure_row_avx(float* row, const float* vx_row, const float* vy_row, const float* vy_down, int count)
+{
+    const __m256 step = _mm256_set1_ps(time_step);
+    __m256 flow;
+    int x;
+
+    for (x = 1;  x < count + 1;  x += 8)
+    {
+        flow = _mm256_sub_ps(_mm256_loadu_ps(vx_row + x - 1), _mm256_loadu_ps(vx_row + x));
+        flow = _mm256_add_ps(flow, _mm256_loadu_ps(vy_down + x));
+        flow = _mm256_sub_ps(flow, _mm256_loadu_ps(vy_row + x));
+        _mm256_storeu_ps(row + x, _mm256_add_ps(_mm256_loadu_ps(row + x), _mm256_mul_ps(flow, step)));
+    }
+}
+
+#endif // WAVE_AVX
+
+static void velocity_row(int y)
+{
+    const float* row = p + y * grid_width;
+    const float* up = p + ((y + 1) % grid_height) * grid_width;
+    float* vx_row = vx + y * grid_width;
+    float* vy_row = vy + y * grid_width;
+    float right;
+    int x = 0;
+
+#ifdef WAVE_AVX
+    if (use_avx)
+    {
+        x = (grid_width - 1) & ~7;
+        velocity_row_avx(row, up, vx_row, vy_row, x);
+    }
+#endif
+
+    for (;  x < grid_width;  x++)
+    {
+        right = x + 1 < grid_width ? row[x + 1] : row[0];
+        vx_row[x] = vx_row[x] + (row[x] - right) * time_step;
+        vy_row[x] = vy_row[x] + (row[x] - up[x]) * time_step;
+    }
+}
+
+static void pressure_row(int y)
+{
+    float* row = p + y * grid_width;
+    const float* vx_row = vx + y * grid_width;
+    const float* vy_row = vy + y * grid_width;
+    const float* vy_down = vy + (y - 1) * grid_width;
+    int x = 1;
+
+#ifdef WAVE_AVX
+    if (use_avx)
+    {
+        x += (grid_width - 1) & ~7;
+        pressure_row_avx(row, vx_row, vy_row, vy_down, x - 1);
+    }
+#endif
+
+    for (;  x < grid_width;  x++)
+        row[x] = row[x] + (vx_row[x - 1] - vx_row[x] + vy_down[x] - vy_row[x]) * time_step;
+}
+
+static void step_band(int first_row, int last_row)
+{
+    int y;
+
+    for (y = first_row;  y < last_row;  y++)
+    {
+        velocity_row(y);
+        if (y > first_row)
+            pressure_row(y);
+    }
+}
+
 void calc_grid(void)
+{
+    int i, first, last;
+
+    time_step = (float) (dt * ANIMATION_SPEED);
+    run_bands(step_band);
+
+    // The first row of every band (row 0 never changes)
+    for (i = 0;  i < pool.count;  i++)
+    {
+        band_rows(i, &first, &last);
+        if (first > 0 && first < last)
+            pressure_row(first);
+    }
+}
+
+
+//========================================================================
+// The original solver: four passes over the whole grid, kept as the
+// reference for the benchmark
+//========================================================================
+
+static float* ax;
+static float* ay;
+
+static void calc_grid_reference(void)
 {
     int x, y, x2, y2;
-    double time_step = dt * ANIMATION_SPEED;
+    float step = (float) (dt * ANIMATION_SPEED);
 
     // Compute accelerations
-    for (x = 0;  x < GRIDW;  x++)
+    for (x = 0;  x < grid_width;  x++)
     {
-        x2 = (x + 1) % GRIDW;
-        for(y = 0; y < GRIDH; y++)
-            ax[x][y] = p[x][y] - p[x2][y];
+        x2 = (x + 1) % grid_width;
+        for (y = 0;  y < grid_height;  y++)
+            ax[y * grid_width + x] = p[y * grid_width + x] - p[y * grid_width + x2];
     }
 
-    for (y = 0;  y < GRIDH;  y++)
+    for (y = 0;  y < grid_height;  y++)
     {
-        y2 = (y + 1) % GRIDH;
-        for(x = 0; x < GRIDW; x++)
-            ay[x][y] = p[x][y] - p[x][y2];
+        y2 = (y + 1) % grid_height;
+        for (x = 0;  x < grid_width;  x++)
+            ay[y * grid_width + x] = p[y * grid_width + x] - p[y2 * grid_width + x];
     }
 
     // Compute speeds
-    for (x = 0;  x < GRIDW;  x++)
+    for (x = 0;  x < grid_width;  x++)
     {
-        for (y = 0;  y < GRIDH;  y++)
+        for (y = 0;  y < grid_height;  y++)
         {
-            vx[x][y] = vx[x][y] + ax[x][y] * time_step;
-            vy[x][y] = vy[x][y] + ay[x][y] * time_step;
+            vx[y * grid_width + x] = vx[y * grid_width + x] + ax[y * grid_width + x] * step;
+            vy[y * grid_width + x] = vy[y * grid_width + x] + ay[y * grid_width + x] * step;
         }
     }
 
     // Compute pressure
-    for (x = 1;  x < GRIDW;  x++)
+    for (x = 1;  x < grid_width;  x++)
     {
         x2 = x - 1;
-        for (y = 1;  y < GRIDH;  y++)
+        for (y = 1;  y < grid_height;  y++)
         {
             y2 = y - 1;
-            p[x][y] = p[x][y] + (vx[x2][y] - vx[x][y] + vy[x][y2] - vy[x][y]) * time_step;
+            p[y * grid_width + x] = p[y * grid_width + x] +
+                (vx[y * grid_width + x2] - vx[y * grid_width + x] +
+                 vy[y2 * grid_width + x] - vy[y * grid_width + x]) * step;
+        }
+    }
+}
+
+
+//========================================================================
+// Benchmark: cells per second of the reference, the fused kernel on one
+// thread and on all of them, for a few grid sizes. The fused kernel has to
+// end up with the same pressure as the reference.
+//========================================================================
+
+static double run_steps(void (*solver)(void), int steps)
+{
+    double start = glfwGetTime();
+    int i;
+
+    init_grid();
+    for (i = 0;  i < steps;  i++)
+        solver();
+
+    return glfwGetTime() - start;
+}
+
+void benchmark(int threads)
+{
+    static const int sizes[] = { 256, 512, 1024, 2048 };
+    double seconds[3], cells, difference;
+    float* expected;
+    int s, i, steps;
+
+    dt = MAX_DELTA_T;
+    printf("size        steps   reference   fused, 1 thread   fused, %2d threads   (Mcells/s)   max difference\n",
+           threads);
+
+    for (s = 0;  s < (int) (sizeof(sizes) / sizeof(sizes[0]));  s++)
+    {
+        grid_width = grid_height = sizes[s];
+        cells = (double) grid_width * grid_height;
+        steps = (int) (50000000.0 / cells) + 1;
+        alloc_grid();
+        ax = calloc(grid_width * grid_height, sizeof(float));
+        ay = calloc(grid_width * grid_height, sizeof(float));
+        expected = malloc(grid_width * grid_height * sizeof(float));
+
+        seconds[0] = run_steps(calc_grid_reference, steps);
+        memcpy(expected, p, grid_width * grid_height * sizeof(float));
+
+        start_threads(1);
+        seconds[1] = run_steps(calc_grid, steps);
+        stop_threads();
+
+        start_threads(threads);
+        seconds[2] = run_steps(calc_grid, steps);
+        stop_threads();
+
+        difference = 0.0;
+        for (i = 0;  i < grid_width * grid_height;  i++)
+        {
+            if (fabs(p[i] - expected[i]) > difference)
+                difference = fabs(p[i] - expected[i]);
         }
+
+        printf("%4dx%-4d %7d %11.1f %17.1f %19.1f %29g\n", grid_width, grid_height, steps,
+               cells * steps / seconds[0] / 1e6, cells * steps / seconds[1] / 1e6,
+               cells * steps / seconds[2] / 1e6, difference);
+
+        free(expected);
+        free(ax);
+        free(ay);
+        free_grid();
     }
 }
 
@@ -387,17 +778,59 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // main
 //========================================================================
 
+static void usage(void)
+{
+    printf("Usage: wave [-bh] [-s size] [-t threads]\n");
+    printf("Options:\n");
+    printf(" -b   Benchmark the solver (cells per second) and exit\n");
+    printf(" -h   Display this help\n");
+    printf(" -s   Grid size in cells per side (default %d)\n", GRID_SIZE);
+    printf(" -t   Solver threads (default: one per CPU)\n");
+}
+
 int main(int argc, char* argv[])
 {
     GLFWwindow* window;
     double t, dt_total, t_old;
-    int width, height;
+    int width, height, ch, threads = cpu_count(), run_benchmark = 0;
+
+    while ((ch = getopt(argc, argv, "bhs:t:")) != -1)
+    {
+        switch (ch)
+        {
+            case 'b':
+                run_benchmark = 1;
+                break;
+            case 'h':
+                usage();
+                exit(EXIT_SUCCESS);
+            case 's':
+                grid_width = grid_height = atoi(optarg);
+                if (grid_width < 2)
+                    grid_width = grid_height = 2;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+        }
+    }
+
+#ifdef WAVE_AVX
+    use_avx = __builtin_cpu_supports("avx");
+#endif
 
     glfwSetErrorCallback(error_callback);
 
     if (!glfwInit())
         exit(EXIT_FAILURE);
 
+    if (run_benchmark)
+    {
+        benchmark(threads);
+        glfwTerminate();
+        exit(EXIT_SUCCESS);
+    }
+
     window = glfwCreateWindow(640, 480, "Wave Simulation", NULL, NULL);
     if (!window)
     {
@@ -418,10 +851,13 @@ int main(int argc, char* argv[])
     glfwGetFramebufferSize(window, &width, &height);
     framebuffer_size_callback(window, width, height);
 
+    // Initialize simulation, the vertex arrays have to exist first
+    alloc_grid();
+    start_threads(threads);
+
     // Initialize OpenGL
     init_opengl();
 
-    // Initialize simulation
     init_vertices();
     init_grid();
     adjust_grid();
@@ -455,6 +891,9 @@ int main(int argc, char* argv[])
         glfwPollEvents();
     }
 
+    stop_threads();
+    free_grid();
+
     exit(EXIT_SUCCESS);
 }
 
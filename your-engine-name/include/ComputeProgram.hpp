@@ -0,0 +1,114 @@
+#ifndef ComputeProgram_hpp
+#define ComputeProgram_hpp
+
+#include <OpenGL/gl3.h>
+#include <ShaderProgram.hpp>
+#include <JobSystem.hpp>
+
+// Compute is GL 4.3, the macOS headers stop at 4.1
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_COMPUTE_WORK_GROUP_SIZE
+#define GL_COMPUTE_WORK_GROUP_SIZE 0x8267
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_ELEMENT_ARRAY_BARRIER_BIT 0x00000002
+#define GL_UNIFORM_BARRIER_BIT 0x00000004
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_PIXEL_BUFFER_BARRIER_BIT 0x00000080
+#define GL_TEXTURE_UPDATE_BARRIER_BIT 0x00000100
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#define GL_ALL_BARRIER_BITS 0xFFFFFFFF
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+
+/*
+  Compute shader program
+  build() compiles a single GL_COMPUTE_SHADER stage (through ShaderProgram, so the binary cache
+  and uniform lookup work the same) and reads the local size back from the program.
+  dispatchInvocations(w, h, d) rounds up to whole work groups -> the shader guards its edges.
+
+  Writes from a dispatch are only visible to later GL work after glMemoryBarrier with the bit of
+  the *consumer*, not the producer:
+    next dispatch reads the SSBO / image      -> GL_SHADER_STORAGE_BARRIER_BIT / GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+    buffer is drawn as vertices / indices     -> GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT / GL_ELEMENT_ARRAY_BARRIER_BIT
+    image is sampled with texture()           -> GL_TEXTURE_FETCH_BARRIER_BIT
+    buffer holds draw / dispatch commands     -> GL_COMMAND_BARRIER_BIT
+    glGetBufferSubData / glMapBuffer readback -> GL_BUFFER_UPDATE_BARRIER_BIT
+    glGetTexImage / glReadPixels readback     -> GL_TEXTURE_UPDATE_BARRIER_BIT / GL_PIXEL_BUFFER_BARRIER_BIT
+
+  Without GL 4.3 / ARB_compute_shader (macOS) supported() is false and build() fails quietly,
+  reference() runs the same kernel written in C++ on the job system instead. Use it to validate the
+  GPU results or as the fallback path. Kernels relying on shared memory / barrier() need their own.
+*/
+
+class ComputeProgram {
+public:
+    ComputeProgram();
+
+    // Needs a current context, loads the 4.3 entry points on the first call
+    static bool supported();
+
+    bool build(const GLchar *source, ShaderCache *cache = NULL);
+    void destroy();
+
+    bool valid() const { return program.valid(); }
+    void use() const { program.use(); }
+    GLint uniform(const char *name) const { return program.uniform(name); }
+    GLuint id() const { return program.id(); }
+    const GLint *localSize() const { return local; }
+
+    // Work groups, the program has to be current (use())
+    void dispatch(GLuint groupsX, GLuint groupsY = 1, GLuint groupsZ = 1);
+    // Enough work groups to cover width x height x depth invocations
+    void dispatchInvocations(GLuint width, GLuint height = 1, GLuint depth = 1);
+
+    // layout (binding = n) buffer ... / layout (binding = n, format) uniform image2D ...
+    // size 0 binds the whole buffer
+    static void bindStorage(GLuint binding, GLuint buffer, GLintptr offset = 0, GLsizeiptr size = 0);
+    static void bindImage(GLuint unit, GLuint texture, GLenum access, GLenum format, GLint level = 0);
+    static void barrier(GLbitfield consumers);
+
+    // CPU reference: kernel(x, y, z) for every invocation, i.e. gl_GlobalInvocationID.
+    // The flattened index range x + width * (y + height * z) is spread over the job system,
+    // so a 1-D dispatch (one row) runs on every worker too. Chunks stay in x order.
+    template <typename Kernel>
+    static void reference(JobSystem &jobs, GLuint width, GLuint height, GLuint depth, const Kernel &kernel) {
+        if (width == 0 || height == 0 || depth == 0) return;
+        int count = (int)(width * height * depth);
+        int grain = count / (jobs.threadCount() * 4);
+        if (grain > 4096) grain = 4096;
+        jobs.parallelFor(0, count, grain, [&](int begin, int end) {
+            GLuint x = (GLuint)begin % width;
+            GLuint row = (GLuint)begin / width;
+            GLuint y = row % height;
+            GLuint z = row / height;
+            for (int i = begin; i < end; i++) {
+                kernel(x, y, z);
+                if (++x == width) {
+                    x = 0;
+                    if (++y == height) {
+                        y = 0;
+                        z++;
+                    }
+                }
+            }
+        });
+    }
+
+private:
+    ShaderProgram program;
+    GLint local[3];
+};
+
+#endif /* ComputeProgram_hpp */
@@ -0,0 +1,68 @@
+#ifndef Culling_hpp
+#define Culling_hpp
+
+#include <VectorMath.hpp>
+#include <vector>
+
+class JobSystem;
+
+/*
+  Frustum culling
+  Planes come straight out of the view-projection matrix (Gribb/Hartmann), normalized so
+  sphere radii can be compared against plane distances, normals point into the frustum.
+  Bounds are packed as structure of arrays and tested 8 at a time with AVX when the CPU has it
+  (picked at runtime), scalar otherwise. Output is a compacted list of visible indices.
+
+  The JobSystem overloads cut the range in chunks, every chunk compacts into its own slice
+  of visible[] and the slices are moved together afterwards, so visible[] needs room for count indices.
+*/
+
+struct Frustum {
+    enum { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+    vmath::vec4 planes[PLANE_COUNT];  // xyz = normal, w = distance
+
+    static Frustum fromMatrix(const vmath::mat4 &viewProjection);
+};
+
+struct SphereBounds {
+    const float *x;
+    const float *y;
+    const float *z;
+    const float *radius;
+};
+
+// Center / half extent form, cheaper to test against a plane than min / max
+struct BoxBounds {
+    const float *centerX;
+    const float *centerY;
+    const float *centerZ;
+    const float *extentX;
+    const float *extentY;
+    const float *extentZ;
+};
+
+class Culler {
+public:
+    Culler();
+
+    Frustum frustum;
+    int chunkSize;  // elements per job for the JobSystem overloads
+
+    void setViewProjection(const vmath::mat4 &viewProjection);
+
+    // Return the number of visible indices written to visible
+    int cullSpheres(const SphereBounds &spheres, int count, int *visible) const;
+    int cullBoxes(const BoxBounds &boxes, int count, int *visible) const;
+    int cullSpheres(JobSystem &jobs, const SphereBounds &spheres, int count, int *visible);
+    int cullBoxes(JobSystem &jobs, const BoxBounds &boxes, int count, int *visible);
+
+    static bool simd();  // AVX path in use
+
+private:
+    std::vector<int> chunkVisible;
+
+    int compactChunks(int *visible);
+};
+
+#endif /* Culling_hpp */
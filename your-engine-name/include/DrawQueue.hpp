@@ -0,0 +1,125 @@
+#ifndef DrawQueue_hpp
+#define DrawQueue_hpp
+
+#include <stddef.h>
+#include <vector>
+#include <OpenGL/gl3.h>
+
+/*
+  Sorted draw queue
+  render() submits DrawItems instead of drawing, the engine sorts them by their 64 bit key once per frame
+  (LSD radix sort, bytes every key shares are skipped) and executes them after render() returns.
+
+  Key layout, most significant first -> what changes least often in the sorted stream:
+    pass 4 | program 12 | material 16 | vertex array 12 | depth 20
+  The key only decides the order, state is taken from the item itself, so ids that don't fit the bits
+  merely sort a bit worse. Opaque passes want depth front to back, blended passes should submit 1 - depth
+  to draw back to front. The pass callback runs whenever the pass changes in the sorted stream and sets the
+  pass' blend / depth state, no run is merged across passes.
+
+  Runs of items with the same program / material / VAO / primitive are merged:
+  - same geometry with consecutive instance ranges -> one instanced draw, the first instance of the batch
+    goes to the instanceOffset uniform (no base instance in GL 3.3 / 4.1), the shader adds it to gl_InstanceID
+  - different geometry (e.g. meshes of one MeshArena) -> one glMultiDrawElementsBaseVertex / glMultiDrawArrays,
+    only for items without instanceOffset (every sub-draw of a multi-draw starts at gl_InstanceID 0)
+*/
+
+struct DrawItem {
+    unsigned long long key;
+    GLuint program;
+    GLuint vertexArray;
+    unsigned material;       // passed to the material callback, 0 = none
+    GLenum mode;             // GL_TRIANGLES, ...
+    GLenum indexType;        // GL_UNSIGNED_INT / SHORT / BYTE, GL_NONE for glDrawArrays
+    GLuint first;            // first index (indexed) or first vertex
+    GLsizei count;
+    GLint baseVertex;
+    GLuint instance;         // first instance, application defined (index into its instance data)
+    GLsizei instanceCount;
+    GLint instanceOffset;    // uniform location receiving the batch's first instance, -1 = don't merge instances
+};
+
+// One draw call of the merged stream, covers order()[begin, end)
+struct DrawBatch {
+    enum {
+        PASS_CHANGED = 1,
+        PROGRAM_CHANGED = 2,
+        MATERIAL_CHANGED = 4,
+        VERTEX_ARRAY_CHANGED = 8
+    };
+
+    unsigned begin;
+    unsigned end;
+    bool multi;              // one multi-draw over every item, else one instanced draw of the first item
+    GLuint instance;         // instanced draw: first instance and count
+    GLsizei instanceCount;
+    unsigned changes;        // state to set before the draw, *_CHANGED bits
+};
+
+class DrawQueue {
+public:
+    // Sets material state (textures, uniforms), called when the material or the program changes
+    typedef void (*MaterialCallback)(unsigned material, GLuint program, void *user);
+    // Sets pass state (blending, depth test / writes), called before the first draw of every pass
+    typedef void (*PassCallback)(unsigned pass, void *user);
+
+    struct Stats {
+        int items;
+        int drawCalls;
+        int passChanges;
+        int programChanges;
+        int materialChanges;
+        int vertexArrayChanges;
+    };
+
+    DrawQueue();
+
+    MaterialCallback materialCallback;
+    void *materialUser;
+    PassCallback passCallback;
+    void *passUser;
+
+    static unsigned long long key(unsigned pass, unsigned program, unsigned material, unsigned vertexArray, float depth);
+    static unsigned pass(unsigned long long key) { return (unsigned)(key >> 60); }
+    // Item with every field set to a plain single non-indexed draw, fill in the rest
+    static DrawItem item(unsigned long long key, GLuint program, GLuint vertexArray, GLenum mode, GLuint first, GLsizei count);
+
+    void submit(const DrawItem &item) { items.push_back(item); }
+    void clear() { items.clear(); }
+    size_t size() const { return items.size(); }
+
+    // Sort, merge and draw everything submitted, then clear
+    void execute();
+    // Only the sort, order() holds item indices afterwards (benchmarks / debugging)
+    void sort();
+    const std::vector<unsigned> &order() const { return sorted; }
+    // Sort and merge without touching GL, batches() holds the draw calls execute() would issue
+    void plan();
+    const std::vector<DrawBatch> &batches() const { return planned; }
+
+    const Stats &lastFrame() const { return stats; }
+
+private:
+    std::vector<DrawItem> items;
+    std::vector<unsigned long long> keys;
+    std::vector<unsigned long long> keysScratch;
+    std::vector<unsigned> sorted;
+    std::vector<unsigned> sortedScratch;
+    std::vector<DrawBatch> planned;
+
+    // Multi-draw arrays, reused every frame
+    std::vector<GLsizei> multiCounts;
+    std::vector<const void *> multiOffsets;
+    std::vector<GLint> multiFirsts;
+    std::vector<GLint> multiBaseVertices;
+
+    Stats stats;
+
+    void addBatch(size_t begin, size_t end, bool multi, GLuint instance, GLsizei instanceCount, unsigned &changes);
+    void drawMulti(const DrawBatch &batch);
+    void drawSingle(const DrawItem &item, GLuint instance, GLsizei instanceCount);
+    static bool sameState(const DrawItem &a, const DrawItem &b);
+    static bool sameGeometry(const DrawItem &a, const DrawItem &b);
+};
+
+#endif /* DrawQueue_hpp */
@@ -3,9 +3,21 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include <math.h>
+#include <atomic>
+#include <thread>
 #include <OpenGL/gl3.h>
 #include <GLFW/glfw3.h>
+#include <Profiler.hpp>
+#include <TripleBuffer.hpp>
+#include <JobSystem.hpp>
+#include <ShaderCache.hpp>
+#include <ShaderProgram.hpp>
+#include <ShaderWatcher.hpp>
+#include <ShaderPreprocessor.hpp>
+#include <GLState.hpp>
+#include <DrawQueue.hpp>
 
 class Engine {
 public:
@@ -14,20 +26,100 @@ public:
     int width;
     int height;
 
+    // Fixed timestep loop
+    // update() runs at a fixed rate, render() gets the interpolation alpha
+    bool fixedTimestep;
+    double updateInterval;  // seconds per update step
+    int maxUpdateSteps;     // catch-up cap per frame (avoids spiral of death)
+
+    // Threaded update
+    // update() runs on a simulation thread at updateInterval, render() stays on the GL thread
+    // Share data through a TripleBuffer: update() fills write() + publish(), render() acquire() + read()
+    bool threadedUpdate;
+
+    // Work-stealing job system, running from startup() until after shutdown()
+    // e.g. jobs.parallelFor(0, count, 256, [&](int begin, int end) { ... });
+    JobSystem jobs;
+    int jobWorkers;  // < 0 -> hardware threads - 1
+
+    // Rebuild programs from loadProgram() when their files change on disk
+    bool hotReload;
+
+    // Program binary cache, pass it to ShaderProgram::build() to skip compiling on the next launch
+    ShaderCache shaderCache;
+
+    // #include / #define expansion for GLSL, hand it to ShaderVariants for uber-shader permutations
+    ShaderPreprocessor shaderPreprocessor;
+
+    // Draws submitted in render() are sorted, batched and issued right after render() returns
+    DrawQueue drawQueue;
+
+    // Headless mode (--headless [--frames N] [--fps F])
+    // Renders into an offscreen framebuffer of a hidden window with a synthetic clock,
+    // runs headlessFrames frames and prints a timing report
+    bool headless;
+    int headlessFrames;
+    double headlessFrameTime;  // synthetic seconds per frame
+
+#ifdef ENGINE_PROFILER
+    // Frame profiler, use PROFILE_SCOPE / PROFILE_GPU_SCOPE(profiler, "name")
+    // Dumped to profile.csv and profile.json when the app closes
+    Profiler profiler;
+#endif
+
     Engine();
     virtual ~Engine();
 
+    virtual void parseArguments(int argc, const char **argv);
     virtual void init();
     virtual void startup();
     virtual void shutdown();
     virtual void run(Engine *app);
+    virtual void update(double dt);
     virtual void render(double currentTime);
+    virtual void render(double currentTime, double alpha);
+
+    // Starts compiling program in the background, polled between frames until it's done
+    // Check program.ready() in render() and draw with a fallback until then
+    void compileAsync(ShaderProgram &program, const ShaderStage *stages, int count);
+
+    // Builds program from shader files, with hotReload it's rebuilt between frames whenever
+    // one of the files is saved (the old program stays when the new one doesn't compile)
+    bool loadProgram(ShaderProgram &program, const ShaderFile *files, int count);
+
+private:
+    double previousTime;
+    double accumulator;
+
+    struct WatchedProgram {
+        ShaderProgram *program;
+        std::vector<GLenum> types;
+        std::vector<std::string> paths;
+    };
+
+    std::vector<ShaderProgram *> pendingPrograms;
+    std::vector<WatchedProgram> watchedPrograms;
+    ShaderWatcher shaderWatcher;
+
+    std::thread simulationThread;
+    std::atomic<bool> simulationRunning;
+
+    GLuint offscreenFramebuffer;
+    GLuint offscreenRenderbuffers[2];
+
+    void frame(double currentTime);
+    bool buildFromFiles(ShaderProgram &program, const WatchedProgram &watched);
+    void reloadChangedShaders();
+    void runWindowed();
+    void runHeadless();
+    void simulationLoop();
 };
 
 #define DECLARE_MAIN(a)                 \
   int main(int argc, const char **argv) \
   {                                     \
     a *app = new a;                     \
+    app->parseArguments(argc, argv);    \
     app->run(app);                      \
     delete app;                         \
     return 0;                           \
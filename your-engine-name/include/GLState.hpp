@@ -0,0 +1,86 @@
+#ifndef GLState_hpp
+#define GLState_hpp
+
+#include <OpenGL/gl3.h>
+
+/*
+  GL state cache
+  Shadows the bindings and fixed-function state that get set over and over (program, VAO, buffers,
+  textures per unit, enable caps, blend, depth, polygon mode) and drops calls that wouldn't change
+  anything. Counts issued vs. elided calls, Engine rolls the counters over every frame.
+
+  There is one GL context per engine, so the shadow is static and every engine class goes through it.
+  The shadow only stays right if the state is always changed through GLState:
+  after raw gl* calls (or third party code) call invalidate(), after deleting an object
+  call the matching *Deleted() so a recycled id isn't mistaken for the old binding.
+*/
+
+class GLState {
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+
+    struct Stats {
+        long long issued;
+        long long elided;
+    };
+
+    // Forget everything, the next call of every kind goes to GL
+    static void invalidate();
+
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vertexArray);
+    static void bindBuffer(GLenum target, GLuint buffer);
+    static void bindTexture(GLuint unit, GLenum target, GLuint texture);
+    static void enable(GLenum capability);
+    static void disable(GLenum capability);
+    static void blendFunc(GLenum source, GLenum destination);
+    static void blendEquation(GLenum mode);
+    static void depthFunc(GLenum function);
+    static void depthMask(GLboolean mask);
+    static void polygonMode(GLenum mode);  // core profile only has GL_FRONT_AND_BACK
+
+    static void programDeleted(GLuint program);
+    static void vertexArrayDeleted(GLuint vertexArray);
+    static void bufferDeleted(GLuint buffer);
+    static void textureDeleted(GLuint texture);
+
+    static GLuint program() { return state.program; }
+
+    // Counters of the last finished frame / since invalidate()
+    static void endFrame();
+    static Stats lastFrame() { return previous; }
+    static Stats total() { return overall; }
+
+private:
+    enum { BUFFER_TARGETS = 9, TEXTURE_TARGETS = 6, CAPABILITIES = 8 };
+
+    struct State {
+        GLuint program;
+        GLuint vertexArray;
+        GLuint buffers[BUFFER_TARGETS];
+        GLuint activeUnit;
+        GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+        int capabilities[CAPABILITIES];  // -1 unknown, 0 disabled, 1 enabled
+        GLenum blendSource;
+        GLenum blendDestination;
+        GLenum blendMode;
+        GLenum depthFunction;
+        int depthWrite;
+        GLenum polygon;
+    };
+
+    static State state;
+    static Stats current;
+    static Stats previous;
+    static Stats overall;
+
+    static int bufferSlot(GLenum target);
+    static int textureSlot(GLenum target);
+    static int capabilitySlot(GLenum capability);
+    static void setCapability(GLenum capability, bool enabled);
+
+    static void issued() { current.issued++; overall.issued++; }
+    static void elided() { current.elided++; overall.elided++; }
+};
+
+#endif /* GLState_hpp */
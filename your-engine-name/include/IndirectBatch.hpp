@@ -0,0 +1,79 @@
+#ifndef IndirectBatch_hpp
+#define IndirectBatch_hpp
+
+#include <vector>
+#include <OpenGL/gl3.h>
+#include <StreamBuffer.hpp>
+
+/*
+  Multi-draw indirect batch
+  The draw commands live in a GL_DRAW_INDIRECT_BUFFER ring (StreamBuffer), begin() hands out the
+  array for this frame and workers fill it in place (e.g. jobs.parallelFor over objects),
+  submit() draws all of them with one glMultiDrawElementsIndirect.
+
+  Per-draw data: every command's baseInstance is its draw index, and attach() feeds a
+  "draw id" vertex attribute (divisor 1) from a buffer holding 0, 1, 2, ... so the shader reads
+  `in uint drawId` and indexes its per-draw data (same value as gl_DrawID for one instance per draw).
+
+  Without GL_ARB_multi_draw_indirect (macOS GL 4.1) begin() returns plain memory and submit() loops instead:
+  glDrawElementsInstancedBaseVertex per command with the draw id attribute moved to the command's
+  baseInstance, the shader doesn't notice the difference.
+*/
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+class IndirectBatch {
+public:
+    IndirectBatch();
+    ~IndirectBatch();
+
+    // maxDraws per frame (at least 1), also the size of the draw id buffer, allowMultiDraw = false forces the fallback
+    bool create(int maxDraws, bool allowMultiDraw = true);
+    void destroy();
+
+    // Point attribute `index` of vao at the draw id buffer (as uint, divisor 1)
+    void attach(GLuint vao, GLuint index);
+
+    // Returns room for count commands this frame (safe to fill from any thread), NULL when too many
+    DrawElementsIndirectCommand *begin(int count);
+    // Expects the program and the vao from attach() to be bound
+    void submit(GLenum mode, GLenum indexType = GL_UNSIGNED_INT);
+
+    static void command(DrawElementsIndirectCommand &command, GLuint drawId, GLuint count, GLuint firstIndex,
+                        GLint baseVertex, GLuint instanceCount = 1) {
+        command.count = count;
+        command.instanceCount = instanceCount;
+        command.firstIndex = firstIndex;
+        command.baseVertex = baseVertex;
+        command.baseInstance = drawId;
+    }
+
+    bool multiDrawIndirect() const { return multiDraw != NULL; }
+    int capacity() const { return maxDraws; }
+    long long apiCalls;  // draw calls issued since create()
+
+private:
+    typedef void (*MultiDrawElementsIndirectFunction)(GLenum mode, GLenum type, const void *indirect,
+                                                     GLsizei drawcount, GLsizei stride);
+
+    StreamBuffer commands;
+    StreamAllocation current;
+    std::vector<DrawElementsIndirectCommand> fallbackCommands;
+    int currentCount;
+    bool frameStarted;  // commands.beginFrame() ran and submit() still has to end it
+    GLuint drawIds;
+    GLuint attachedIndex;
+    int maxDraws;
+    MultiDrawElementsIndirectFunction multiDraw;
+
+    IndirectBatch(const IndirectBatch &);
+    IndirectBatch &operator=(const IndirectBatch &);
+};
+
+#endif /* IndirectBatch_hpp */
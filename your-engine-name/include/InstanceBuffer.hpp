@@ -0,0 +1,54 @@
+#ifndef InstanceBuffer_hpp
+#define InstanceBuffer_hpp
+
+#include <vector>
+#include <OpenGL/gl3.h>
+#include <StreamBuffer.hpp>
+#include <VertexAttribute.hpp>
+
+/*
+  Per-instance attribute stream
+  Interleaved per-instance data (offsets, colors, transforms, ...) written every frame into a
+  StreamBuffer ring, attached to a VAO with glVertexAttribDivisor(index, 1), drawn with one
+  glDraw*Instanced call for any number of instances.
+
+  Per frame: begin(count) -> fill count * stride bytes -> draw*() (once or more, same data)
+  begin() may be filled from worker threads, draw*() binds the VAO and points the attributes at
+  this frame's slice of the ring, the shader side is plain `in` variables.
+*/
+
+class InstanceBuffer {
+public:
+    InstanceBuffer();
+
+    // stride = bytes per instance, maxInstances per frame
+    bool create(const VertexAttribute *attributes, int attributeCount, GLsizei stride, int maxInstances);
+    void destroy();
+
+    // Enables the attributes with divisor 1 on vao, the per-vertex attributes stay as they are
+    void attach(GLuint vao);
+
+    // Room for count instances, NULL when count > maxInstances (draws are skipped, still call end())
+    void *begin(int count);
+    void drawArrays(GLenum mode, GLint first, GLsizei vertexCount);
+    void drawElements(GLenum mode, GLsizei indexCount, GLenum indexType, GLuint firstIndex, GLint baseVertex = 0);
+    // Fences this frame's slice, call once after the last draw of the frame
+    void end();
+
+    int instances() const { return count; }
+    GLsizei stride() const { return instanceStride; }
+
+private:
+    StreamBuffer stream;
+    StreamAllocation current;
+    std::vector<VertexAttribute> attributes;
+    GLsizei instanceStride;
+    GLuint vao;
+    int maxInstances;
+    int count;
+    GLintptr pointedAt;  // offset the attribute pointers currently use
+
+    void point();
+};
+
+#endif /* InstanceBuffer_hpp */
@@ -0,0 +1,128 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+  Work-stealing job system
+  Every worker owns a Chase-Lev deque: the owner pushes/pops at the bottom (LIFO, cache warm),
+  idle workers steal from the top (FIFO, oldest = usually biggest chunk of work).
+  The thread that calls start() is worker 0, so workerCount + 1 threads execute jobs.
+  Threads outside the system (e.g. the simulation thread) submit through a small locked queue.
+  A job whose dependency hasn't finished goes to the back of that queue, so everything else runs first.
+
+  Jobs are plain function pointers + data + range, stored by value in the deque ring -> no allocations.
+  A thief copies the job out before its CAS on top, the owner can only reuse that slot after top moved.
+  Slot fields are relaxed atomics so that copy racing a refill is defined (plain moves on x86).
+  Completion is tracked with JobCounter, wait() keeps executing jobs instead of blocking.
+*/
+
+struct JobCounter {
+    std::atomic<int> value;
+    JobCounter() : value(0) {}
+    bool done() const { return value.load(std::memory_order_acquire) == 0; }
+};
+
+typedef void (*JobFunction)(void *data, int begin, int end);
+
+struct Job {
+    JobFunction function;
+    void *data;
+    int begin;
+    int end;
+    JobCounter *counter;     // decremented when the job finished
+    JobCounter *dependency;  // job is held back until this counter reaches zero
+};
+
+class JobQueue {
+public:
+    static const int CAPACITY = 4096;
+
+    JobQueue() : top(0), bottom(0) {}
+
+    bool push(const Job &job);  // owner only, false when full
+    bool pop(Job &job);         // owner only
+    bool steal(Job &job);       // any thread
+
+private:
+    struct Slot {
+        std::atomic<JobFunction> function;
+        std::atomic<void *> data;
+        std::atomic<int> begin;
+        std::atomic<int> end;
+        std::atomic<JobCounter *> counter;
+        std::atomic<JobCounter *> dependency;
+
+        void store(const Job &job);
+        void load(Job &job) const;
+    };
+
+    // Keep the thieves' end and the owner's end on separate cache lines
+    std::atomic<long long> top;
+    char topPadding[64 - sizeof(std::atomic<long long>)];
+    std::atomic<long long> bottom;
+    char bottomPadding[64 - sizeof(std::atomic<long long>)];
+    Slot jobs[CAPACITY];
+};
+
+class JobSystem {
+public:
+    JobSystem();
+    ~JobSystem();
+
+    // workerCount < 0 -> hardware threads - 1
+    void start(int workerCount = -1);
+    void stop();
+
+    // Threads executing jobs, including the one that called start()
+    int threadCount() const { return (int)queues.size(); }
+
+    void run(JobFunction function, void *data, int begin, int end,
+             JobCounter *counter, JobCounter *dependency = NULL);
+    void wait(JobCounter *counter);
+
+    // body(begin, end) is called for chunks of at most grain elements, returns when all are done
+    template <typename Body>
+    void parallelFor(int begin, int end, int grain, const Body &body) {
+        if (grain < 1) grain = 1;
+        if (queues.size() <= 1 || end - begin <= grain) {
+            if (begin < end) body(begin, end);
+            return;
+        }
+        JobCounter counter;
+        for (int i = begin; i < end; i += grain) {
+            run(&invokeRange<Body>, (void *)&body, i, i + grain < end ? i + grain : end, &counter);
+        }
+        wait(&counter);
+    }
+
+private:
+    std::vector<JobQueue *> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex injectedLock;
+    std::deque<Job> injected;  // FIFO, also holds jobs waiting on a dependency
+
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::atomic<int> pendingJobs;
+    std::atomic<int> sleepers;
+    std::atomic<bool> running;
+
+    int currentWorker() const;
+    void push(const Job &job);
+    bool execute(int worker);
+    void workerLoop(int worker);
+
+    template <typename Body>
+    static void invokeRange(void *data, int begin, int end) {
+        (*(const Body *)data)(begin, end);
+    }
+};
+
+#endif /* JobSystem_hpp */
@@ -0,0 +1,84 @@
+#ifndef MeshArena_hpp
+#define MeshArena_hpp
+
+#include <vector>
+#include <OpenGL/gl3.h>
+#include <RangeAllocator.hpp>
+#include <VertexAttribute.hpp>
+
+/*
+  Mesh arena
+  Packs the vertices and indices of many static meshes with the same vertex format into one vertex
+  buffer + one index buffer, sub-allocated with RangeAllocator (TLSF). One VAO covers every mesh,
+  a draw only needs its baseVertex / firstIndex -> glDrawElementsBaseVertex, no rebinding between meshes.
+
+  Buffers grow (doubling) when a mesh doesn't fit, defragment() packs the live meshes to the front
+  after lots of add/remove churn. Both rebuild the buffers and reattach them to the same VAO,
+  mesh handles and the VAO id stay valid, only baseVertex / firstIndex change.
+*/
+
+struct MeshRange {
+    GLint baseVertex;
+    GLuint firstIndex;
+    GLsizei vertexCount;
+    GLsizei indexCount;
+};
+
+class MeshArena {
+public:
+    static const unsigned INVALID = 0xFFFFFFFFu;
+
+    MeshArena();
+    ~MeshArena();
+
+    // Initial capacities in vertices / indices (GL_UNSIGNED_INT), buffers grow on demand
+    bool create(const VertexAttribute *attributes, int attributeCount, GLsizei stride,
+                GLuint vertexCapacity, GLuint indexCapacity);
+    void destroy();
+
+    // Returns a mesh handle, indices are relative to the mesh's first vertex
+    unsigned add(const void *vertices, GLuint vertexCount, const GLuint *indices, GLuint indexCount);
+    void remove(unsigned mesh);
+    void defragment();
+
+    const MeshRange &range(unsigned mesh) const { return meshes[mesh].range; }
+
+    void bind() const;
+    // Expects bind(), every draw after that is one call without state changes
+    void draw(unsigned mesh, GLenum mode = GL_TRIANGLES) const;
+
+    GLuint vertexArray() const { return vao; }
+    GLuint vertexBuffer() const { return vbo; }
+    GLuint indexBuffer() const { return ibo; }
+
+    // Free space split in many small holes -> time to defragment()
+    float vertexFragmentation() const;
+    float indexFragmentation() const;
+
+private:
+    struct Mesh {
+        unsigned vertexBlock;
+        unsigned indexBlock;
+        MeshRange range;
+        bool live;
+    };
+
+    std::vector<VertexAttribute> attributes;
+    GLsizei stride;
+    GLuint vao;
+    GLuint vbo;
+    GLuint ibo;
+    RangeAllocator vertices;
+    RangeAllocator indices;
+    std::vector<Mesh> meshes;
+    std::vector<unsigned> freeMeshes;
+
+    void rebuild(GLuint vertexCapacity, GLuint indexCapacity);
+    void attach();
+    static float fragmentation(const RangeAllocator &allocator);
+
+    MeshArena(const MeshArena &);
+    MeshArena &operator=(const MeshArena &);
+};
+
+#endif /* MeshArena_hpp */
@@ -0,0 +1,107 @@
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <OpenGL/gl3.h>
+
+/*
+  Frame profiler
+  CPU scopes are timed with a steady clock, GPU scopes with GL_TIMESTAMP queries.
+  GPU results are read back FRAME_LATENCY frames later so we never stall the pipeline.
+  All storage is allocated once in the constructor -> no allocations while profiling.
+
+  Only compiled in with ENGINE_PROFILER defined, the PROFILE_* macros expand to nothing otherwise.
+*/
+
+class Profiler {
+public:
+    static const int HISTORY_FRAMES = 256;  // frames kept for the dump at shutdown
+    static const int MAX_SCOPES = 64;       // CPU scopes per frame
+    static const int MAX_GPU_SCOPES = 16;   // GPU scopes per frame
+    static const int MAX_DEPTH = 16;
+    static const int FRAME_LATENCY = 4;     // frames before GPU queries are read back
+
+    struct Event {
+        const char *name;
+        double start;   // seconds since profiler startup
+        double end;
+        int depth;
+    };
+
+    Profiler();
+    ~Profiler();
+
+    // Needs a current GL context
+    void startup();
+    void shutdown();
+
+    void beginFrame();
+    void endFrame();
+
+    int beginCpu(const char *name);
+    void endCpu(int index);
+    int beginGpu(const char *name);
+    void endGpu(int index);
+
+    // Average duration of a CPU/GPU scope over the recorded history in milliseconds
+    double averageCpu(const char *name) const;
+    double averageGpu(const char *name) const;
+
+    bool dumpCsv(const char *path) const;
+    bool dumpChromeTrace(const char *path) const;
+
+private:
+    struct Frame {
+        long long number;
+        int cpuCount;
+        int gpuCount;
+        bool gpuResolved;
+    };
+
+    Frame *frames;
+    Event *cpuEvents;  // HISTORY_FRAMES * MAX_SCOPES
+    Event *gpuEvents;  // HISTORY_FRAMES * MAX_GPU_SCOPES
+    GLuint *queries;   // FRAME_LATENCY * MAX_GPU_SCOPES * 2 (begin/end timestamps)
+
+    long long frameNumber;
+    int stack[MAX_DEPTH];
+    int stackSize;
+    bool queriesReady;
+    double gpuOffset;  // GPU timestamp (s) - CPU time (s), to line both up in traces
+
+    double now() const;
+    Frame &currentFrame() { return frames[frameNumber % HISTORY_FRAMES]; }
+    void resolveGpu(long long number, bool wait);
+};
+
+// Scoped helpers, closes the scope at the end of the block
+class ProfileScope {
+public:
+    ProfileScope(Profiler &p, const char *name, bool gpu)
+        : profiler(p), gpu(gpu) {
+        index = gpu ? profiler.beginGpu(name) : profiler.beginCpu(name);
+    }
+    ~ProfileScope() {
+        if (gpu) profiler.endGpu(index);
+        else profiler.endCpu(index);
+    }
+
+private:
+    Profiler &profiler;
+    bool gpu;
+    int index;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef ENGINE_PROFILER
+#define PROFILE_SCOPE(profiler, name) \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(profiler, name, false)
+#define PROFILE_GPU_SCOPE(profiler, name) \
+    ProfileScope PROFILE_CONCAT(profileGpuScope, __LINE__)(profiler, name, true)
+#else
+#define PROFILE_SCOPE(profiler, name)
+#define PROFILE_GPU_SCOPE(profiler, name)
+#endif
+
+#endif /* Profiler_hpp */
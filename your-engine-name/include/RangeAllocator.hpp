@@ -0,0 +1,67 @@
+#ifndef RangeAllocator_hpp
+#define RangeAllocator_hpp
+
+#include <vector>
+
+/*
+  TLSF (two level segregated fit) allocator for ranges of a GPU buffer
+  Only bookkeeping, never touches memory -> units are whatever the caller wants (vertices, indices, bytes).
+  Free blocks sit in 32 x 16 size classes, two bitmaps find a fitting class with a couple of bit scans,
+  so allocate() and free() are O(1). Freed blocks merge with free physical neighbours right away.
+  Blocks are addressed by index into a node array, so handles stay small and the allocator never allocates
+  after warm up.
+*/
+
+class RangeAllocator {
+public:
+    static const unsigned INVALID = 0xFFFFFFFFu;
+
+    RangeAllocator();
+
+    void reset(unsigned capacity);
+    // Adds free space at the end, e.g. after the GPU buffer was reallocated bigger
+    void grow(unsigned capacity);
+
+    // Returns a block handle or INVALID
+    unsigned allocate(unsigned size);
+    void free(unsigned block);
+
+    unsigned offset(unsigned block) const { return blocks[block].offset; }
+    unsigned size(unsigned block) const { return blocks[block].size; }
+
+    unsigned capacity() const { return total; }
+    unsigned used() const { return allocated; }
+    unsigned largestFree() const;
+
+private:
+    enum { SL_LOG2 = 4, SL_COUNT = 1 << SL_LOG2, FL_COUNT = 32 - SL_LOG2 + 1 };
+
+    struct Block {
+        unsigned offset;
+        unsigned size;
+        unsigned prevPhysical;
+        unsigned nextPhysical;
+        unsigned prevFree;
+        unsigned nextFree;
+        bool free;
+    };
+
+    std::vector<Block> blocks;
+    unsigned unusedNodes;  // recycled node indices, linked through nextFree
+    unsigned lastBlock;    // physically last block, grow() extends it
+    unsigned total;
+    unsigned allocated;
+
+    unsigned firstLevelMap;
+    unsigned secondLevelMap[FL_COUNT];
+    unsigned heads[FL_COUNT][SL_COUNT];
+
+    unsigned newNode();
+    void releaseNode(unsigned node);
+    static void mapping(unsigned size, int &fl, int &sl);
+    void insertFree(unsigned block);
+    void removeFree(unsigned block);
+    unsigned findFree(unsigned size);
+};
+
+#endif /* RangeAllocator_hpp */
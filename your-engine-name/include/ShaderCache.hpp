@@ -0,0 +1,41 @@
+#ifndef ShaderCache_hpp
+#define ShaderCache_hpp
+
+#include <string>
+#include <OpenGL/gl3.h>
+
+/*
+  Program binary cache
+  Linked programs are saved with glGetProgramBinary and reloaded with glProgramBinary on the next launch.
+  Key = hash of every stage (type + source) and the GL vendor/renderer/version strings,
+  so a driver update or an edited shader simply misses and compiles from source again.
+  ShaderProgram::build() takes a cache and does the load / compile / store dance.
+*/
+
+struct ShaderStage {
+    GLenum type;
+    const GLchar *source;
+};
+
+class ShaderCache {
+public:
+    std::string directory;
+    bool enabled;
+    int hits;
+    int misses;
+
+    ShaderCache();
+
+    unsigned long long key(const ShaderStage *stages, int count);
+
+    // Fill program from the cached binary, false on a miss or when the driver rejects it
+    bool load(GLuint program, unsigned long long key);
+    void store(GLuint program, unsigned long long key);
+
+private:
+    std::string driver;
+
+    std::string path(unsigned long long key) const;
+};
+
+#endif /* ShaderCache_hpp */
@@ -0,0 +1,77 @@
+#ifndef ShaderPreprocessor_hpp
+#define ShaderPreprocessor_hpp
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <ShaderProgram.hpp>
+
+/*
+  GLSL preprocessor
+  GLSL has no #include, so shared code gets pasted in here before the driver sees it:
+  - #include "file" / <file>, relative to the including file first, then includePaths
+  - #pragma once in included files
+  - defines are injected right after #version (which has to stay the first statement)
+  #line directives keep error messages pointing at the right line, the source string number
+  is the index into files().
+*/
+
+struct ShaderDefine {
+    std::string name;
+    std::string value;
+};
+
+typedef std::vector<ShaderDefine> ShaderDefines;
+
+class ShaderPreprocessor {
+public:
+    std::vector<std::string> includePaths;
+
+    bool process(const std::string &path, const ShaderDefines &defines, std::string &output);
+    bool processSource(const std::string &source, const std::string &path,
+                       const ShaderDefines &defines, std::string &output);
+
+    // Every file the last process() call read, in #line source string order
+    const std::vector<std::string> &files() const { return fileNames; }
+
+    // Order independent "A=1;B;" string, used as permutation key
+    static std::string key(const ShaderDefines &defines);
+
+private:
+    std::vector<std::string> fileNames;
+    std::set<std::string> onceFiles;
+
+    bool expand(const std::string &source, const std::string &path, int depth,
+                const ShaderDefines *defines, std::string &output);
+    bool resolve(const std::string &name, const std::string &from, std::string &path) const;
+};
+
+/*
+  Permutations of one "uber" program
+  get(defines) preprocesses and compiles a variant the first time it's asked for and keeps it,
+  so only the variants actually used at runtime are ever built. Programs go through the
+  binary cache, keyed on the preprocessed source.
+*/
+
+class ShaderVariants {
+public:
+    ShaderVariants();
+
+    void setup(const ShaderFile *files, int count, ShaderPreprocessor *preprocessor, ShaderCache *cache = NULL);
+    void destroy();
+
+    // NULL when the variant failed to build (the failure is remembered too)
+    ShaderProgram *get(const ShaderDefines &defines);
+
+    int size() const { return (int)variants.size(); }
+
+private:
+    std::vector<ShaderFile> stages;
+    std::vector<std::string> paths;
+    ShaderPreprocessor *preprocessor;
+    ShaderCache *cache;
+    std::map<std::string, ShaderProgram> variants;
+};
+
+#endif /* ShaderPreprocessor_hpp */
@@ -0,0 +1,92 @@
+#ifndef ShaderProgram_hpp
+#define ShaderProgram_hpp
+
+#include <string>
+#include <vector>
+#include <OpenGL/gl3.h>
+#include <ShaderCache.hpp>
+#include <GLState.hpp>
+
+/*
+  Shader program built from any set of stages
+  Compile and link status are checked and the logs printed on failure.
+  Every active uniform and uniform block is looked up once after linking and kept in a flat
+  (open addressing) hash table -> uniform("name") never calls into GL, safe to use in render().
+
+  submit() + poll() compile without blocking: all stages and the link are issued up front and,
+  with KHR_parallel_shader_compile, poll() asks GL_COMPLETION_STATUS_KHR instead of waiting.
+  Keep drawing with a fallback program until ready(), Engine::compileAsync() does the polling.
+*/
+
+// Shader stage living in a file, see Engine::loadProgram()
+struct ShaderFile {
+    GLenum type;
+    const char *path;
+};
+
+class ShaderProgram {
+public:
+    enum Status { EMPTY, PENDING, READY, FAILED };
+
+    ShaderProgram();
+    ~ShaderProgram() { destroy(); }
+
+    // Pass a cache to try the program binary first and store it after a fresh link
+    bool build(const ShaderStage *stages, int count, ShaderCache *cache = NULL);
+    void destroy();
+
+    // Non-blocking build: submit() issues the work, poll() returns true once it's READY or FAILED
+    void submit(const ShaderStage *stages, int count, ShaderCache *cache = NULL);
+    bool poll();
+    bool wait();
+
+    Status status() const { return state; }
+    bool ready() const { return state == READY; }
+
+    GLuint id() const { return program; }
+    bool valid() const { return program != 0; }
+    void use() const { GLState::useProgram(program); }
+
+    // Exchange GL program and reflection data, used to put a rebuilt program in place
+    void swap(ShaderProgram &other);
+
+    // -1 / GL_INVALID_INDEX when the program has no such (active) uniform
+    // Arrays are found by "lights" / "lights[0]" and by every active element, "lights[2]"
+    GLint uniform(const char *name) const;
+    GLuint uniformBlock(const char *name) const;
+
+    // Compile one stage, prints the info log and returns 0 on failure
+    static GLuint compileStage(const ShaderStage &stage);
+    static bool readSource(const std::string &path, std::string &source);
+
+    // Checks for KHR/ARB_parallel_shader_compile and lets the driver use its compiler threads
+    static bool enableParallelCompile();
+
+private:
+    struct Entry {
+        unsigned int hash;
+        std::string name;
+        GLint location;
+        GLuint block;
+
+        Entry() : hash(0), location(-1), block(GL_INVALID_INDEX) {}
+    };
+
+    GLuint program;
+    Status state;
+    std::vector<GLuint> pendingShaders;
+    ShaderCache *pendingCache;
+    unsigned long long pendingKey;
+    std::vector<Entry> table;  // power of two size, hash == 0 marks an empty slot
+
+    static unsigned int hashName(const char *name, size_t length);
+    void finish();
+    void reflect();
+    Entry &insert(const char *name, size_t length);
+    const Entry *find(const char *name) const;
+
+    ShaderProgram(const ShaderProgram &);
+    ShaderProgram &operator=(const ShaderProgram &);
+};
+
+#endif /* ShaderProgram_hpp */
@@ -0,0 +1,47 @@
+#ifndef ShaderWatcher_hpp
+#define ShaderWatcher_hpp
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+  Watches shader files on a background thread and collects the ones that changed
+  Linux uses inotify on the parent directories (editors like to save by renaming a new file
+  over the old one, which a watch on the file itself would miss), other platforms poll mtimes.
+  The render thread picks the changes up with takeChanged() between frames.
+*/
+
+class ShaderWatcher {
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    void watch(const std::string &path);
+    void stop();
+
+    // Moves the paths that changed since the last call into changed
+    bool takeChanged(std::vector<std::string> &changed);
+
+private:
+    std::thread thread;
+    std::atomic<bool> running;
+    std::mutex lock;
+    std::set<std::string> files;            // guarded by lock
+    std::set<std::string> changedFiles;     // guarded by lock
+    std::map<std::string, long long> mtimes;  // polling fallback, watcher thread only
+
+#ifdef __linux__
+    int inotifyFd;
+    std::map<int, std::string> directories;  // watch descriptor -> directory prefix, guarded by lock
+#endif
+
+    void start();
+    void watchLoop();
+};
+
+#endif /* ShaderWatcher_hpp */
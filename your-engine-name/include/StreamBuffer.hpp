@@ -0,0 +1,71 @@
+#ifndef StreamBuffer_hpp
+#define StreamBuffer_hpp
+
+#include <stddef.h>
+#include <OpenGL/gl3.h>
+
+/*
+  Ring buffer for per-frame dynamic data (vertices, uniforms, ...)
+  One buffer split in `frames` regions, the CPU writes region N while the GPU still reads N-1, N-2.
+  Every region gets a fence when its frame ends, beginFrame() only waits when the GPU is that far behind.
+
+  With GL_ARB_buffer_storage the buffer is mapped once, persistent + coherent -> allocate() returns
+  a pointer straight into GPU visible memory, no glBufferSubData copies, no implicit syncs.
+  Without it (e.g. macOS GL 4.1) writes go to a CPU copy of the region and flush() uploads them,
+  so always call flush() after writing and before drawing, it's free on the persistent path.
+
+  Per frame: beginFrame() -> allocate() / write / flush() -> draw -> endFrame()
+*/
+
+struct StreamAllocation {
+    void *pointer;      // write here, NULL when the region is full
+    GLuint buffer;
+    GLintptr offset;    // offset in buffer -> glVertexAttribPointer / glBindBufferRange
+    GLsizeiptr size;
+
+    bool valid() const { return pointer != NULL; }
+};
+
+class StreamBuffer {
+public:
+    static const int MAX_FRAMES = 4;
+
+    long long stalls;     // beginFrame() had to wait for the GPU
+    long long overflows;  // allocate() did not fit in the region
+
+    StreamBuffer();
+    ~StreamBuffer();
+
+    // frameSize = bytes available per frame, frames = regions in flight (2..MAX_FRAMES)
+    bool create(GLenum target, GLsizeiptr frameSize, int frames = 3);
+    void destroy();
+
+    void beginFrame();
+    // alignment has to be a power of two, uniformAlignment() for glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+    StreamAllocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+    void flush();
+    void endFrame();
+
+    GLuint id() const { return buffer; }
+    GLenum target() const { return bufferTarget; }
+    bool persistent() const { return mapped != NULL; }
+    static GLsizeiptr uniformAlignment();
+
+private:
+    GLuint buffer;
+    GLenum bufferTarget;
+    GLsizeiptr regionSize;
+    int regionCount;
+    int region;
+    GLsizeiptr head;     // bytes allocated in the current region
+    GLsizeiptr flushed;  // bytes of the current region already uploaded (fallback path)
+    GLsync fences[MAX_FRAMES];
+
+    unsigned char *mapped;   // persistent mapping of the whole buffer
+    unsigned char *staging;  // fallback: CPU copy of one region
+
+    StreamBuffer(const StreamBuffer &);
+    StreamBuffer &operator=(const StreamBuffer &);
+};
+
+#endif /* StreamBuffer_hpp */
@@ -0,0 +1,35 @@
+#ifndef TransformBatch_hpp
+#define TransformBatch_hpp
+
+#include <VectorMath.hpp>
+
+/*
+  Batched transform kernels
+  One matrix against many inputs instead of one mat4x4_mul per object:
+  - transformPoints: positions as structure of arrays (x[], y[], z[], w = 1) -> clip/world space SoA
+  - multiply: out[i] = m * models[i], e.g. view-projection * every model matrix of the scene
+
+  The kernel is picked once at runtime (AVX2 + FMA if the CPU has it, SSE, scalar),
+  so one binary runs everywhere and still uses the wide path on machines that support it.
+  Kernels only look at [0, count), split big batches with JobSystem::parallelFor.
+*/
+
+class TransformBatch {
+public:
+    enum Path { SCALAR, SSE, AVX2 };
+
+    // Widest path this CPU supports
+    static Path best();
+    static Path path();
+    // Benchmarks / debugging, clamped to best(), not thread safe
+    static void setPath(Path path);
+    static const char *name(Path path);
+
+    // outW may be null when only xyz is needed (affine matrices)
+    static void transformPoints(const vmath::mat4 &m, const float *x, const float *y, const float *z,
+                                float *outX, float *outY, float *outZ, float *outW, int count);
+
+    static void multiply(const vmath::mat4 &m, const vmath::mat4 *models, vmath::mat4 *out, int count);
+};
+
+#endif /* TransformBatch_hpp */
@@ -0,0 +1,50 @@
+#ifndef TripleBuffer_hpp
+#define TripleBuffer_hpp
+
+#include <atomic>
+
+/*
+  Lock-free triple buffer for handing frame packets from one producer thread to one consumer thread
+  Producer fills write() and calls publish(), consumer calls acquire() and reads read()
+  -> producer never waits on the consumer, consumer always sees the latest complete packet
+  Middle slot index lives in one atomic together with a "new data" bit.
+*/
+
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), backIndex(0), frontIndex(2) {}
+
+    // Producer side
+    T &write() { return buffers[backIndex]; }
+
+    void publish() {
+        backIndex = middle.exchange(backIndex | DIRTY, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Consumer side, returns false when nothing new was published since the last call
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & DIRTY)) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T &read() const { return buffers[frontIndex]; }
+
+private:
+    static const int INDEX_MASK = 3;
+    static const int DIRTY = 4;
+
+    // Padded so producer and consumer don't fight over one cache line. Plain padding instead of
+    // alignas(64): samples keep it as a member and DECLARE_MAIN creates them with new, and C++11
+    // operator new doesn't honor over-alignment (GCC warns with -Waligned-new).
+    T buffers[3];
+    char buffersPadding[64];  // keeps the tail of the last packet off middle's line
+    std::atomic<int> middle;
+    char middlePadding[64 - sizeof(std::atomic<int>)];
+    int backIndex;   // only touched by the producer
+    char backPadding[64 - sizeof(int)];
+    int frontIndex;  // only touched by the consumer
+};
+
+#endif /* TripleBuffer_hpp */
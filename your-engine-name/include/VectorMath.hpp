@@ -0,0 +1,629 @@
+#ifndef VectorMath_hpp
+#define VectorMath_hpp
+
+#include <math.h>
+
+/*
+  Vector / matrix math (see OpenGLSuperBible6/13-math-for-3d-graphics)
+  vecN<T, len> and matNM<T, cols, rows> are plain templates that work for any size,
+  matrices are column major like OpenGL expects -> m[column][row], data() can go to glUniformMatrix4fv.
+
+  The hot float4 / mat4 paths (mat4 * vec4, mat4 * mat4, inverse, dot) have SIMD overloads,
+  picked at compile time: AVX when built with -mavx (ENGINE_NATIVE_ARCH), SSE on any x86-64,
+  plain scalar loops everywhere else (e.g. ARM).
+*/
+
+#if !defined(VMATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define VMATH_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(VMATH_SSE) && defined(__AVX__)
+#define VMATH_AVX 1
+#include <immintrin.h>
+#endif
+
+namespace vmath {
+
+template <typename T>
+inline T radians(T angle) { return angle * T(0.0174532925199432957692369076849); }
+
+template <typename T>
+inline T degrees(T angle) { return angle * T(57.2957795130823208767981548141); }
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  VECTORS                                                         │
+// └──────────────────────────────────────────────────────────────────┘
+template <typename T, int len>
+class vecN {
+public:
+    typedef T element_type;
+    static const int size = len;
+
+    vecN() {}
+
+    explicit vecN(T value) {
+        for (int i = 0; i < len; i++) v[i] = value;
+    }
+
+    T &operator[](int n) { return v[n]; }
+    const T &operator[](int n) const { return v[n]; }
+
+    T *data() { return v; }
+    const T *data() const { return v; }
+
+    vecN operator+(const vecN &that) const {
+        vecN result;
+        for (int i = 0; i < len; i++) result.v[i] = v[i] + that.v[i];
+        return result;
+    }
+
+    vecN operator-(const vecN &that) const {
+        vecN result;
+        for (int i = 0; i < len; i++) result.v[i] = v[i] - that.v[i];
+        return result;
+    }
+
+    vecN operator*(const vecN &that) const {
+        vecN result;
+        for (int i = 0; i < len; i++) result.v[i] = v[i] * that.v[i];
+        return result;
+    }
+
+    vecN operator/(const vecN &that) const {
+        vecN result;
+        for (int i = 0; i < len; i++) result.v[i] = v[i] / that.v[i];
+        return result;
+    }
+
+    vecN operator*(T scale) const {
+        vecN result;
+        for (int i = 0; i < len; i++) result.v[i] = v[i] * scale;
+        return result;
+    }
+
+    vecN operator/(T scale) const {
+        vecN result;
+        for (int i = 0; i < len; i++) result.v[i] = v[i] / scale;
+        return result;
+    }
+
+    vecN operator-() const {
+        vecN result;
+        for (int i = 0; i < len; i++) result.v[i] = -v[i];
+        return result;
+    }
+
+    vecN &operator+=(const vecN &that) { return *this = *this + that; }
+    vecN &operator-=(const vecN &that) { return *this = *this - that; }
+    vecN &operator*=(const vecN &that) { return *this = *this * that; }
+    vecN &operator*=(T scale) { return *this = *this * scale; }
+    vecN &operator/=(T scale) { return *this = *this / scale; }
+
+    T dot(const vecN &that) const;
+    vecN cross(const vecN &that) const;
+
+protected:
+    T v[len];
+};
+
+template <typename T>
+class Tvec2 : public vecN<T, 2> {
+public:
+    Tvec2() {}
+    explicit Tvec2(T value) : vecN<T, 2>(value) {}
+    Tvec2(const vecN<T, 2> &that) : vecN<T, 2>(that) {}
+    Tvec2(T x, T y) {
+        this->v[0] = x;
+        this->v[1] = y;
+    }
+};
+
+template <typename T>
+class Tvec3 : public vecN<T, 3> {
+public:
+    Tvec3() {}
+    explicit Tvec3(T value) : vecN<T, 3>(value) {}
+    Tvec3(const vecN<T, 3> &that) : vecN<T, 3>(that) {}
+    Tvec3(T x, T y, T z) {
+        this->v[0] = x;
+        this->v[1] = y;
+        this->v[2] = z;
+    }
+};
+
+template <typename T>
+class Tvec4 : public vecN<T, 4> {
+public:
+    Tvec4() {}
+    explicit Tvec4(T value) : vecN<T, 4>(value) {}
+    Tvec4(const vecN<T, 4> &that) : vecN<T, 4>(that) {}
+    Tvec4(T x, T y, T z, T w) {
+        this->v[0] = x;
+        this->v[1] = y;
+        this->v[2] = z;
+        this->v[3] = w;
+    }
+    Tvec4(const vecN<T, 3> &xyz, T w) {
+        this->v[0] = xyz[0];
+        this->v[1] = xyz[1];
+        this->v[2] = xyz[2];
+        this->v[3] = w;
+    }
+};
+
+typedef Tvec2<float> vec2;
+typedef Tvec3<float> vec3;
+typedef Tvec4<float> vec4;
+typedef Tvec2<int> ivec2;
+typedef Tvec3<int> ivec3;
+typedef Tvec4<int> ivec4;
+typedef Tvec3<double> dvec3;
+typedef Tvec4<double> dvec4;
+
+template <typename T, int len>
+inline vecN<T, len> operator*(T scale, const vecN<T, len> &v) {
+    return v * scale;
+}
+
+template <typename T, int len>
+inline T dot(const vecN<T, len> &a, const vecN<T, len> &b) {
+    T total = T(0);
+    for (int i = 0; i < len; i++) total += a[i] * b[i];
+    return total;
+}
+
+template <typename T, int len>
+inline T vecN<T, len>::dot(const vecN &that) const {
+    return vmath::dot(*this, that);
+}
+
+// Only defined for 3 component vectors, order matters
+template <typename T>
+inline vecN<T, 3> cross(const vecN<T, 3> &a, const vecN<T, 3> &b) {
+    return Tvec3<T>(a[1] * b[2] - b[1] * a[2],
+                    a[2] * b[0] - b[2] * a[0],
+                    a[0] * b[1] - b[0] * a[1]);
+}
+
+template <typename T, int len>
+inline vecN<T, len> vecN<T, len>::cross(const vecN &that) const {
+    return vmath::cross(*this, that);
+}
+
+template <typename T, int len>
+inline T length(const vecN<T, len> &v) {
+    return T(sqrt(dot(v, v)));
+}
+
+template <typename T, int len>
+inline vecN<T, len> normalize(const vecN<T, len> &v) {
+    return v / length(v);
+}
+
+template <typename T, int len>
+inline T distance(const vecN<T, len> &a, const vecN<T, len> &b) {
+    return length(b - a);
+}
+
+// Angle between two vectors in radians
+template <typename T, int len>
+inline T angle(const vecN<T, len> &a, const vecN<T, len> &b) {
+    return T(acos(dot(a, b) / (length(a) * length(b))));
+}
+
+template <typename T, int len>
+inline vecN<T, len> reflect(const vecN<T, len> &incident, const vecN<T, len> &normal) {
+    return incident - normal * (T(2) * dot(normal, incident));
+}
+
+// eta = ratio of the indices of refraction, zero vector on total internal reflection
+template <typename T, int len>
+inline vecN<T, len> refract(const vecN<T, len> &incident, const vecN<T, len> &normal, T eta) {
+    T d = dot(normal, incident);
+    T k = T(1) - eta * eta * (T(1) - d * d);
+    if (k < T(0)) return vecN<T, len>(T(0));
+    return incident * eta - normal * (eta * d + T(sqrt(k)));
+}
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  MATRICES                                                        │
+// └──────────────────────────────────────────────────────────────────┘
+template <typename T, int cols, int rows>
+class matNM {
+public:
+    typedef vecN<T, rows> column_type;
+
+    matNM() {}
+
+    // Diagonal matrix, matNM(1) is the identity
+    explicit matNM(T diagonal) {
+        for (int c = 0; c < cols; c++) {
+            for (int r = 0; r < rows; r++) m[c][r] = c == r ? diagonal : T(0);
+        }
+    }
+
+    static matNM identity() { return matNM(T(1)); }
+
+    column_type &operator[](int column) { return m[column]; }
+    const column_type &operator[](int column) const { return m[column]; }
+
+    T *data() { return m[0].data(); }
+    const T *data() const { return m[0].data(); }
+
+    matNM operator+(const matNM &that) const {
+        matNM result;
+        for (int c = 0; c < cols; c++) result.m[c] = m[c] + that.m[c];
+        return result;
+    }
+
+    matNM operator-(const matNM &that) const {
+        matNM result;
+        for (int c = 0; c < cols; c++) result.m[c] = m[c] - that.m[c];
+        return result;
+    }
+
+    matNM operator*(T scale) const {
+        matNM result;
+        for (int c = 0; c < cols; c++) result.m[c] = m[c] * scale;
+        return result;
+    }
+
+    matNM<T, rows, cols> transpose() const {
+        matNM<T, rows, cols> result;
+        for (int c = 0; c < cols; c++) {
+            for (int r = 0; r < rows; r++) result[r][c] = m[c][r];
+        }
+        return result;
+    }
+
+protected:
+    column_type m[cols];
+};
+
+template <typename T>
+class Tmat4 : public matNM<T, 4, 4> {
+public:
+    Tmat4() {}
+    explicit Tmat4(T diagonal) : matNM<T, 4, 4>(diagonal) {}
+    Tmat4(const matNM<T, 4, 4> &that) : matNM<T, 4, 4>(that) {}
+    Tmat4(const vecN<T, 4> &c0, const vecN<T, 4> &c1, const vecN<T, 4> &c2, const vecN<T, 4> &c3) {
+        this->m[0] = c0;
+        this->m[1] = c1;
+        this->m[2] = c2;
+        this->m[3] = c3;
+    }
+};
+
+template <typename T>
+class Tmat3 : public matNM<T, 3, 3> {
+public:
+    Tmat3() {}
+    explicit Tmat3(T diagonal) : matNM<T, 3, 3>(diagonal) {}
+    Tmat3(const matNM<T, 3, 3> &that) : matNM<T, 3, 3>(that) {}
+    Tmat3(const vecN<T, 3> &c0, const vecN<T, 3> &c1, const vecN<T, 3> &c2) {
+        this->m[0] = c0;
+        this->m[1] = c1;
+        this->m[2] = c2;
+    }
+};
+
+typedef Tmat3<float> mat3;
+typedef Tmat4<float> mat4;
+typedef Tmat4<double> dmat4;
+
+// Matrix * column vector
+template <typename T, int cols, int rows>
+inline vecN<T, rows> operator*(const matNM<T, cols, rows> &m, const vecN<T, cols> &v) {
+    vecN<T, rows> result(T(0));
+    for (int c = 0; c < cols; c++) result += m[c] * v[c];
+    return result;
+}
+
+// Matrix * matrix, (cols x rows) * (n x cols) -> (n x rows)
+template <typename T, int cols, int rows, int n>
+inline matNM<T, n, rows> operator*(const matNM<T, cols, rows> &a, const matNM<T, n, cols> &b) {
+    matNM<T, n, rows> result;
+    for (int c = 0; c < n; c++) result[c] = a * b[c];
+    return result;
+}
+
+template <typename T, int cols, int rows>
+inline matNM<T, rows, cols> transpose(const matNM<T, cols, rows> &m) {
+    return m.transpose();
+}
+
+// Gauss-Jordan with partial pivoting, any square size, returns the zero matrix when singular
+template <typename T, int n>
+inline matNM<T, n, n> inverse(const matNM<T, n, n> &m) {
+    matNM<T, n, n> a = m;
+    matNM<T, n, n> result(T(1));
+
+    for (int c = 0; c < n; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < n; r++) {
+            if (fabs(a[c][r]) > fabs(a[c][pivot])) pivot = r;
+        }
+        if (a[c][pivot] == T(0)) return matNM<T, n, n>(T(0));
+
+        // Swap rows c and pivot
+        for (int k = 0; k < n; k++) {
+            T t = a[k][c]; a[k][c] = a[k][pivot]; a[k][pivot] = t;
+            t = result[k][c]; result[k][c] = result[k][pivot]; result[k][pivot] = t;
+        }
+
+        T scale = T(1) / a[c][c];
+        for (int k = 0; k < n; k++) {
+            a[k][c] *= scale;
+            result[k][c] *= scale;
+        }
+        for (int r = 0; r < n; r++) {
+            if (r == c) continue;
+            T factor = a[c][r];
+            for (int k = 0; k < n; k++) {
+                a[k][r] -= factor * a[k][c];
+                result[k][r] -= factor * result[k][c];
+            }
+        }
+    }
+    return result;
+}
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  SIMD FLOAT4 / MAT4                                              │
+// └──────────────────────────────────────────────────────────────────┘
+// Exact-type overloads, preferred by the compiler over the templates above
+#ifdef VMATH_SSE
+
+inline __m128 load(const vecN<float, 4> &v) { return _mm_loadu_ps(v.data()); }
+
+inline vecN<float, 4> store(__m128 value) {
+    vecN<float, 4> result;
+    _mm_storeu_ps(result.data(), value);
+    return result;
+}
+
+inline float dot(const vecN<float, 4> &a, const vecN<float, 4> &b) {
+    __m128 product = _mm_mul_ps(load(a), load(b));
+    __m128 swapped = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(product, swapped);
+    swapped = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_cvtss_f32(_mm_add_ss(sums, swapped));
+}
+
+// Broadcast each component of v and sum the scaled columns
+inline __m128 transform(const float *m, __m128 v) {
+    __m128 result = _mm_mul_ps(_mm_loadu_ps(m), _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+    return result;
+}
+
+inline vecN<float, 4> operator*(const matNM<float, 4, 4> &m, const vecN<float, 4> &v) {
+    return store(transform(m.data(), load(v)));
+}
+
+inline matNM<float, 4, 4> operator*(const matNM<float, 4, 4> &a, const matNM<float, 4, 4> &b) {
+    matNM<float, 4, 4> result;
+    const float *pa = a.data();
+    const float *pb = b.data();
+    float *pr = result.data();
+#ifdef VMATH_AVX
+    // Two result columns per iteration
+    __m256 a0 = _mm256_broadcast_ps((const __m128 *)(pa));
+    __m256 a1 = _mm256_broadcast_ps((const __m128 *)(pa + 4));
+    __m256 a2 = _mm256_broadcast_ps((const __m128 *)(pa + 8));
+    __m256 a3 = _mm256_broadcast_ps((const __m128 *)(pa + 12));
+    for (int c = 0; c < 4; c += 2) {
+        __m256 columns = _mm256_loadu_ps(pb + c * 4);
+        __m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(columns, _MM_SHUFFLE(0, 0, 0, 0)));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(a1, _mm256_permute_ps(columns, _MM_SHUFFLE(1, 1, 1, 1))));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(a2, _mm256_permute_ps(columns, _MM_SHUFFLE(2, 2, 2, 2))));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(a3, _mm256_permute_ps(columns, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm256_storeu_ps(pr + c * 4, sum);
+    }
+#else
+    for (int c = 0; c < 4; c++) {
+        _mm_storeu_ps(pr + c * 4, transform(pa, _mm_loadu_ps(pb + c * 4)));
+    }
+#endif
+    return result;
+}
+
+namespace detail {
+
+// 2x2 blocks packed in one register as (m00 m01 m10 m11)
+inline __m128 swizzle(__m128 v, int mask) {
+    return _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(v), mask));
+}
+
+// A * B
+inline __m128 mat2Mul(__m128 a, __m128 b) {
+    return _mm_add_ps(_mm_mul_ps(a, swizzle(b, _MM_SHUFFLE(3, 0, 3, 0))),
+                      _mm_mul_ps(swizzle(a, _MM_SHUFFLE(2, 3, 0, 1)), swizzle(b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// adj(A) * B
+inline __m128 mat2AdjMul(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(swizzle(a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+                      _mm_mul_ps(swizzle(a, _MM_SHUFFLE(2, 2, 1, 1)), swizzle(b, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+// A * adj(B)
+inline __m128 mat2MulAdj(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, swizzle(b, _MM_SHUFFLE(0, 3, 0, 3))),
+                      _mm_mul_ps(swizzle(a, _MM_SHUFFLE(2, 3, 0, 1)), swizzle(b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+} // namespace detail
+
+// Block-wise 2x2 inverse, general matrices (not only rigid transforms)
+inline matNM<float, 4, 4> inverse(const matNM<float, 4, 4> &m) {
+    using namespace detail;
+    const float *p = m.data();
+    __m128 c0 = _mm_loadu_ps(p);
+    __m128 c1 = _mm_loadu_ps(p + 4);
+    __m128 c2 = _mm_loadu_ps(p + 8);
+    __m128 c3 = _mm_loadu_ps(p + 12);
+
+    // Sub matrices, inverse(transpose(M)) = transpose(inverse(M)) so columns work as rows
+    __m128 A = _mm_movelh_ps(c0, c1);
+    __m128 B = _mm_movehl_ps(c1, c0);
+    __m128 C = _mm_movelh_ps(c2, c3);
+    __m128 D = _mm_movehl_ps(c3, c2);
+
+    // (|A| |B| |C| |D|)
+    __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1))),
+        _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m128 detA = swizzle(detSub, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 detB = swizzle(detSub, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 detC = swizzle(detSub, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 detD = swizzle(detSub, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128 DC = mat2AdjMul(D, C);
+    __m128 AB = mat2AdjMul(A, B);
+    __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), mat2Mul(B, DC));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), mat2Mul(C, AB));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), mat2MulAdj(D, AB));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), mat2MulAdj(A, DC));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 detM = _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC));
+    __m128 trace = _mm_mul_ps(AB, swizzle(DC, _MM_SHUFFLE(3, 1, 2, 0)));
+    trace = _mm_add_ps(trace, swizzle(trace, _MM_SHUFFLE(2, 3, 0, 1)));
+    trace = _mm_add_ps(trace, swizzle(trace, _MM_SHUFFLE(1, 0, 3, 2)));
+    detM = _mm_sub_ps(detM, trace);
+
+    // Singular -> zero matrix, same as the scalar and Gauss-Jordan paths
+    if (_mm_cvtss_f32(detM) == 0.0f) return matNM<float, 4, 4>(0.0f);
+
+    __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X = _mm_mul_ps(X, rDetM);
+    Y = _mm_mul_ps(Y, rDetM);
+    Z = _mm_mul_ps(Z, rDetM);
+    W = _mm_mul_ps(W, rDetM);
+
+    matNM<float, 4, 4> result;
+    float *r = result.data();
+    _mm_storeu_ps(r, _mm_shuffle_ps(X, Y, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(r + 4, _mm_shuffle_ps(X, Y, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_storeu_ps(r + 8, _mm_shuffle_ps(Z, W, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(r + 12, _mm_shuffle_ps(Z, W, _MM_SHUFFLE(0, 2, 0, 2)));
+    return result;
+}
+
+#else
+
+// Scalar 4x4 through 2x2 sub determinants (cofactor expansion), much cheaper than Gauss-Jordan
+inline matNM<float, 4, 4> inverse(const matNM<float, 4, 4> &m) {
+    float s[6], c[6];
+    s[0] = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    s[1] = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    s[2] = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    s[3] = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    s[4] = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    s[5] = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    c[0] = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+    c[1] = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    c[2] = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    c[3] = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    c[4] = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    c[5] = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+
+    float det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+    if (det == 0.0f) return matNM<float, 4, 4>(0.0f);
+    float idet = 1.0f / det;
+
+    matNM<float, 4, 4> t;
+    t[0][0] = ( m[1][1] * c[5] - m[1][2] * c[4] + m[1][3] * c[3]) * idet;
+    t[0][1] = (-m[0][1] * c[5] + m[0][2] * c[4] - m[0][3] * c[3]) * idet;
+    t[0][2] = ( m[3][1] * s[5] - m[3][2] * s[4] + m[3][3] * s[3]) * idet;
+    t[0][3] = (-m[2][1] * s[5] + m[2][2] * s[4] - m[2][3] * s[3]) * idet;
+
+    t[1][0] = (-m[1][0] * c[5] + m[1][2] * c[2] - m[1][3] * c[1]) * idet;
+    t[1][1] = ( m[0][0] * c[5] - m[0][2] * c[2] + m[0][3] * c[1]) * idet;
+    t[1][2] = (-m[3][0] * s[5] + m[3][2] * s[2] - m[3][3] * s[1]) * idet;
+    t[1][3] = ( m[2][0] * s[5] - m[2][2] * s[2] + m[2][3] * s[1]) * idet;
+
+    t[2][0] = ( m[1][0] * c[4] - m[1][1] * c[2] + m[1][3] * c[0]) * idet;
+    t[2][1] = (-m[0][0] * c[4] + m[0][1] * c[2] - m[0][3] * c[0]) * idet;
+    t[2][2] = ( m[3][0] * s[4] - m[3][1] * s[2] + m[3][3] * s[0]) * idet;
+    t[2][3] = (-m[2][0] * s[4] + m[2][1] * s[2] - m[2][3] * s[0]) * idet;
+
+    t[3][0] = (-m[1][0] * c[3] + m[1][1] * c[1] - m[1][2] * c[0]) * idet;
+    t[3][1] = ( m[0][0] * c[3] - m[0][1] * c[1] + m[0][2] * c[0]) * idet;
+    t[3][2] = (-m[3][0] * s[3] + m[3][1] * s[1] - m[3][2] * s[0]) * idet;
+    t[3][3] = ( m[2][0] * s[3] - m[2][1] * s[1] + m[2][2] * s[0]) * idet;
+    return t;
+}
+
+#endif /* VMATH_SSE */
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  TRANSFORMS                                                      │
+// └──────────────────────────────────────────────────────────────────┘
+template <typename T>
+inline Tmat4<T> translate(T x, T y, T z) {
+    return Tmat4<T>(Tvec4<T>(1, 0, 0, 0),
+                    Tvec4<T>(0, 1, 0, 0),
+                    Tvec4<T>(0, 0, 1, 0),
+                    Tvec4<T>(x, y, z, 1));
+}
+
+template <typename T>
+inline Tmat4<T> scale(T x, T y, T z) {
+    return Tmat4<T>(Tvec4<T>(x, 0, 0, 0),
+                    Tvec4<T>(0, y, 0, 0),
+                    Tvec4<T>(0, 0, z, 0),
+                    Tvec4<T>(0, 0, 0, 1));
+}
+
+// Rotation of angle degrees around the axis (x, y, z)
+template <typename T>
+inline Tmat4<T> rotate(T angle, T x, T y, T z) {
+    const T r = radians(angle);
+    const T c = T(cos(r));
+    const T s = T(sin(r));
+    const T omc = T(1) - c;
+    T len = T(sqrt(x * x + y * y + z * z));
+    x /= len;
+    y /= len;
+    z /= len;
+
+    return Tmat4<T>(Tvec4<T>(x * x * omc + c, y * x * omc + z * s, x * z * omc - y * s, 0),
+                    Tvec4<T>(x * y * omc - z * s, y * y * omc + c, y * z * omc + x * s, 0),
+                    Tvec4<T>(x * z * omc + y * s, y * z * omc - x * s, z * z * omc + c, 0),
+                    Tvec4<T>(0, 0, 0, 1));
+}
+
+// fovy in degrees
+template <typename T>
+inline Tmat4<T> perspective(T fovy, T aspect, T n, T f) {
+    T q = T(1) / T(tan(radians(T(0.5) * fovy)));
+    T A = q / aspect;
+    T B = (n + f) / (n - f);
+    T C = (T(2) * n * f) / (n - f);
+
+    return Tmat4<T>(Tvec4<T>(A, 0, 0, 0),
+                    Tvec4<T>(0, q, 0, 0),
+                    Tvec4<T>(0, 0, B, -1),
+                    Tvec4<T>(0, 0, C, 0));
+}
+
+template <typename T>
+inline Tmat4<T> lookat(const vecN<T, 3> &eye, const vecN<T, 3> &center, const vecN<T, 3> &up) {
+    const Tvec3<T> f = normalize(center - eye);
+    const Tvec3<T> s = normalize(cross(f, up));
+    const Tvec3<T> u = cross(s, f);
+
+    return Tmat4<T>(Tvec4<T>(s[0], u[0], -f[0], 0),
+                    Tvec4<T>(s[1], u[1], -f[1], 0),
+                    Tvec4<T>(s[2], u[2], -f[2], 0),
+                    Tvec4<T>(-dot(s, eye), -dot(u, eye), dot(f, eye), 1));
+}
+
+} // namespace vmath
+
+#endif /* VectorMath_hpp */
@@ -0,0 +1,20 @@
+#ifndef VertexAttribute_hpp
+#define VertexAttribute_hpp
+
+#include <stddef.h>
+#include <OpenGL/gl3.h>
+
+/*
+  One float vertex attribute inside an interleaved vertex / instance, as passed to glVertexAttribPointer
+  (integer types are converted, normalized or not). A mat4 takes 4 of these, one per column.
+*/
+
+struct VertexAttribute {
+    GLuint index;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+#endif /* VertexAttribute_hpp */
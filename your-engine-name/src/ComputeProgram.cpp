@@ -0,0 +1,73 @@
+#include <ComputeProgram.hpp>
+#include <GLFW/glfw3.h>
+
+typedef void (*DispatchComputeFunction)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (*MemoryBarrierFunction)(GLbitfield barriers);
+typedef void (*BindImageTextureFunction)(GLuint unit, GLuint texture, GLint level, GLboolean layered,
+                                         GLint layer, GLenum access, GLenum format);
+
+static DispatchComputeFunction dispatchCompute = NULL;
+static MemoryBarrierFunction memoryBarrier = NULL;
+static BindImageTextureFunction bindImageTexture = NULL;
+
+ComputeProgram::ComputeProgram() {
+    local[0] = local[1] = local[2] = 1;
+}
+
+bool ComputeProgram::supported() {
+    static int checked = -1;
+    if (checked >= 0) return checked == 1;
+
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool core = major > 4 || (major == 4 && minor >= 3);
+    if (core || glfwExtensionSupported("GL_ARB_compute_shader")) {
+        dispatchCompute = (DispatchComputeFunction)glfwGetProcAddress("glDispatchCompute");
+        memoryBarrier = (MemoryBarrierFunction)glfwGetProcAddress("glMemoryBarrier");
+        bindImageTexture = (BindImageTextureFunction)glfwGetProcAddress("glBindImageTexture");
+    }
+    checked = dispatchCompute && memoryBarrier && bindImageTexture ? 1 : 0;
+    return checked == 1;
+}
+
+bool ComputeProgram::build(const GLchar *source, ShaderCache *cache) {
+    destroy();
+    if (!supported()) return false;
+
+    ShaderStage stage = {GL_COMPUTE_SHADER, source};
+    if (!program.build(&stage, 1, cache)) return false;
+    glGetProgramiv(program.id(), GL_COMPUTE_WORK_GROUP_SIZE, local);
+    return true;
+}
+
+void ComputeProgram::destroy() {
+    program.destroy();
+    local[0] = local[1] = local[2] = 1;
+}
+
+void ComputeProgram::dispatch(GLuint groupsX, GLuint groupsY, GLuint groupsZ) {
+    if (!dispatchCompute || !program.valid()) return;
+    dispatchCompute(groupsX, groupsY, groupsZ);
+}
+
+void ComputeProgram::dispatchInvocations(GLuint width, GLuint height, GLuint depth) {
+    dispatch((width + local[0] - 1) / local[0],
+             (height + local[1] - 1) / local[1],
+             (depth + local[2] - 1) / local[2]);
+}
+
+// glBindBufferBase also moves the generic GL_SHADER_STORAGE_BUFFER binding, GLState doesn't track that one
+void ComputeProgram::bindStorage(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if (size == 0) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+    else glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, offset, size);
+}
+
+void ComputeProgram::bindImage(GLuint unit, GLuint texture, GLenum access, GLenum format, GLint level) {
+    if (bindImageTexture) bindImageTexture(unit, texture, level, GL_FALSE, 0, access, format);
+}
+
+void ComputeProgram::barrier(GLbitfield consumers) {
+    if (memoryBarrier) memoryBarrier(consumers);
+}
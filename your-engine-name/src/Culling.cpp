@@ -0,0 +1,225 @@
+#include <Culling.hpp>
+#include <JobSystem.hpp>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CULLING_AVX 1
+#include <immintrin.h>
+#define AVX_TARGET __attribute__((target("avx")))
+#endif
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  FRUSTUM                                                         │
+// └──────────────────────────────────────────────────────────────────┘
+Frustum Frustum::fromMatrix(const vmath::mat4 &m) {
+    // Row r of a column major matrix is (m[0][r], m[1][r], m[2][r], m[3][r])
+    vmath::vec4 rows[4];
+    for (int r = 0; r < 4; r++) rows[r] = vmath::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+
+    Frustum frustum;
+    frustum.planes[PLANE_LEFT] = rows[3] + rows[0];
+    frustum.planes[PLANE_RIGHT] = rows[3] - rows[0];
+    frustum.planes[PLANE_BOTTOM] = rows[3] + rows[1];
+    frustum.planes[PLANE_TOP] = rows[3] - rows[1];
+    frustum.planes[PLANE_NEAR] = rows[3] + rows[2];
+    frustum.planes[PLANE_FAR] = rows[3] - rows[2];
+
+    for (int i = 0; i < PLANE_COUNT; i++) {
+        vmath::vec4 &plane = frustum.planes[i];
+        float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f) plane /= length;
+    }
+    return frustum;
+}
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  KERNELS                                                         │
+// └──────────────────────────────────────────────────────────────────┘
+// Kernels test [begin, end) and write absolute indices, return how many were visible
+
+static int cullSpheresScalar(const Frustum &frustum, const SphereBounds &s, int begin, int end, int *visible) {
+    int written = 0;
+    for (int i = begin; i < end; i++) {
+        bool inside = true;
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            const vmath::vec4 &plane = frustum.planes[p];
+            float distance = plane[0] * s.x[i] + plane[1] * s.y[i] + plane[2] * s.z[i] + plane[3];
+            inside &= distance >= -s.radius[i];
+        }
+        // Branchless compaction, always write and only advance when visible
+        visible[written] = i;
+        written += inside;
+    }
+    return written;
+}
+
+static int cullBoxesScalar(const Frustum &frustum, const BoxBounds &b, int begin, int end, int *visible) {
+    int written = 0;
+    for (int i = begin; i < end; i++) {
+        bool inside = true;
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            const vmath::vec4 &plane = frustum.planes[p];
+            float distance = plane[0] * b.centerX[i] + plane[1] * b.centerY[i] + plane[2] * b.centerZ[i] + plane[3];
+            float radius = fabsf(plane[0]) * b.extentX[i] + fabsf(plane[1]) * b.extentY[i] +
+                           fabsf(plane[2]) * b.extentZ[i];
+            inside &= distance >= -radius;
+        }
+        visible[written] = i;
+        written += inside;
+    }
+    return written;
+}
+
+#ifdef CULLING_AVX
+
+AVX_TARGET
+static inline int compact(int mask, int base, int *visible) {
+    int written = 0;
+    for (int bit = 0; bit < 8; bit++) {
+        visible[written] = base + bit;
+        written += (mask >> bit) & 1;
+    }
+    return written;
+}
+
+AVX_TARGET
+static int cullSpheresAvx(const Frustum &frustum, const SphereBounds &s, int begin, int end, int *visible) {
+    __m256 planes[Frustum::PLANE_COUNT][4];
+    for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+        for (int k = 0; k < 4; k++) planes[p][k] = _mm256_set1_ps(frustum.planes[p][k]);
+    }
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+    int written = 0;
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(s.x + i);
+        __m256 y = _mm256_loadu_ps(s.y + i);
+        __m256 z = _mm256_loadu_ps(s.z + i);
+        __m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(s.radius + i), signBit);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), planes[p][3]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][1], y));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][2], z));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+        written += compact(_mm256_movemask_ps(inside), i, visible + written);
+    }
+    return written + cullSpheresScalar(frustum, s, i, end, visible + written);
+}
+
+AVX_TARGET
+static int cullBoxesAvx(const Frustum &frustum, const BoxBounds &b, int begin, int end, int *visible) {
+    __m256 planes[Frustum::PLANE_COUNT][4];
+    __m256 absolute[Frustum::PLANE_COUNT][3];
+    for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+        for (int k = 0; k < 4; k++) planes[p][k] = _mm256_set1_ps(frustum.planes[p][k]);
+        for (int k = 0; k < 3; k++) absolute[p][k] = _mm256_set1_ps(fabsf(frustum.planes[p][k]));
+    }
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+    int written = 0;
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(b.centerX + i);
+        __m256 y = _mm256_loadu_ps(b.centerY + i);
+        __m256 z = _mm256_loadu_ps(b.centerZ + i);
+        __m256 ex = _mm256_loadu_ps(b.extentX + i);
+        __m256 ey = _mm256_loadu_ps(b.extentY + i);
+        __m256 ez = _mm256_loadu_ps(b.extentZ + i);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), planes[p][3]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][1], y));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][2], z));
+            __m256 radius = _mm256_mul_ps(absolute[p][0], ex);
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(absolute[p][1], ey));
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(absolute[p][2], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(radius, signBit), _CMP_GE_OQ));
+        }
+        written += compact(_mm256_movemask_ps(inside), i, visible + written);
+    }
+    return written + cullBoxesScalar(frustum, b, i, end, visible + written);
+}
+
+#endif /* CULLING_AVX */
+
+static bool detectAvx() {
+#ifdef CULLING_AVX
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+#else
+    return false;
+#endif
+}
+
+static int cullSpheresRange(const Frustum &frustum, const SphereBounds &s, int begin, int end, int *visible) {
+#ifdef CULLING_AVX
+    if (Culler::simd()) return cullSpheresAvx(frustum, s, begin, end, visible);
+#endif
+    return cullSpheresScalar(frustum, s, begin, end, visible);
+}
+
+static int cullBoxesRange(const Frustum &frustum, const BoxBounds &b, int begin, int end, int *visible) {
+#ifdef CULLING_AVX
+    if (Culler::simd()) return cullBoxesAvx(frustum, b, begin, end, visible);
+#endif
+    return cullBoxesScalar(frustum, b, begin, end, visible);
+}
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  CULLER                                                          │
+// └──────────────────────────────────────────────────────────────────┘
+Culler::Culler() {
+    frustum = Frustum::fromMatrix(vmath::mat4::identity());
+    chunkSize = 16384;
+}
+
+bool Culler::simd() {
+    static bool avx = detectAvx();
+    return avx;
+}
+
+void Culler::setViewProjection(const vmath::mat4 &viewProjection) {
+    frustum = Frustum::fromMatrix(viewProjection);
+}
+
+int Culler::cullSpheres(const SphereBounds &spheres, int count, int *visible) const {
+    return cullSpheresRange(frustum, spheres, 0, count, visible);
+}
+
+int Culler::cullBoxes(const BoxBounds &boxes, int count, int *visible) const {
+    return cullBoxesRange(frustum, boxes, 0, count, visible);
+}
+
+int Culler::cullSpheres(JobSystem &jobs, const SphereBounds &spheres, int count, int *visible) {
+    if (chunkSize < 1) chunkSize = 1;  // public, compactChunks relies on it too
+    chunkVisible.resize((count + chunkSize - 1) / chunkSize);
+    jobs.parallelFor(0, count, chunkSize, [&](int begin, int end) {
+        chunkVisible[begin / chunkSize] = cullSpheresRange(frustum, spheres, begin, end, visible + begin);
+    });
+    return compactChunks(visible);
+}
+
+int Culler::cullBoxes(JobSystem &jobs, const BoxBounds &boxes, int count, int *visible) {
+    if (chunkSize < 1) chunkSize = 1;
+    chunkVisible.resize((count + chunkSize - 1) / chunkSize);
+    jobs.parallelFor(0, count, chunkSize, [&](int begin, int end) {
+        chunkVisible[begin / chunkSize] = cullBoxesRange(frustum, boxes, begin, end, visible + begin);
+    });
+    return compactChunks(visible);
+}
+
+// Chunk k wrote its indices at visible + k * chunkSize, close the gaps
+int Culler::compactChunks(int *visible) {
+    int written = 0;
+    for (size_t k = 0; k < chunkVisible.size(); k++) {
+        int *source = visible + k * chunkSize;
+        if (source != visible + written) memmove(visible + written, source, chunkVisible[k] * sizeof(int));
+        written += chunkVisible[k];
+    }
+    return written;
+}
@@ -0,0 +1,246 @@
+#include <DrawQueue.hpp>
+#include <GLState.hpp>
+
+static size_t indexSize(GLenum type) {
+    switch (type) {
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        default: return 4;
+    }
+}
+
+DrawQueue::DrawQueue() {
+    materialCallback = NULL;
+    materialUser = NULL;
+    passCallback = NULL;
+    passUser = NULL;
+    Stats empty = {0, 0, 0, 0, 0, 0};
+    stats = empty;
+}
+
+unsigned long long DrawQueue::key(unsigned pass, unsigned program, unsigned material, unsigned vertexArray, float depth) {
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    unsigned long long quantized = (unsigned long long)(depth * 0xFFFFF);
+    return ((unsigned long long)(pass & 0xF) << 60) |
+           ((unsigned long long)(program & 0xFFF) << 48) |
+           ((unsigned long long)(material & 0xFFFF) << 32) |
+           ((unsigned long long)(vertexArray & 0xFFF) << 20) |
+           quantized;
+}
+
+DrawItem DrawQueue::item(unsigned long long key, GLuint program, GLuint vertexArray, GLenum mode, GLuint first, GLsizei count) {
+    DrawItem item;
+    item.key = key;
+    item.program = program;
+    item.vertexArray = vertexArray;
+    item.material = 0;
+    item.mode = mode;
+    item.indexType = GL_NONE;
+    item.first = first;
+    item.count = count;
+    item.baseVertex = 0;
+    item.instance = 0;
+    item.instanceCount = 1;
+    item.instanceOffset = -1;
+    return item;
+}
+
+// LSD radix sort, 8 bits per pass, index array follows the keys
+void DrawQueue::sort() {
+    size_t n = items.size();
+    keys.resize(n);
+    keysScratch.resize(n);
+    sorted.resize(n);
+    sortedScratch.resize(n);
+
+    unsigned long long differing = 0;
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = items[i].key;
+        sorted[i] = (unsigned)i;
+        differing |= keys[i] ^ keys[0];
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        // Every key has the same byte here -> the pass wouldn't move anything
+        if (!((differing >> shift) & 0xFF)) continue;
+
+        size_t offsets[256] = {0};
+        for (size_t i = 0; i < n; i++) offsets[(keys[i] >> shift) & 0xFF]++;
+        size_t total = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t count = offsets[b];
+            offsets[b] = total;
+            total += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t target = offsets[(keys[i] >> shift) & 0xFF]++;
+            keysScratch[target] = keys[i];
+            sortedScratch[target] = sorted[i];
+        }
+        keys.swap(keysScratch);
+        sorted.swap(sortedScratch);
+    }
+}
+
+void DrawQueue::plan() {
+    sort();
+    planned.clear();
+
+    const DrawItem *previous = NULL;
+    size_t i = 0;
+    while (i < sorted.size()) {
+        const DrawItem &item = items[sorted[i]];
+
+        // State changes, only where the sorted stream actually changes
+        unsigned changes = 0;
+        if (!previous || pass(previous->key) != pass(item.key)) changes |= DrawBatch::PASS_CHANGED;
+        if (!previous || previous->program != item.program) changes |= DrawBatch::PROGRAM_CHANGED;
+        if (!previous || previous->vertexArray != item.vertexArray) changes |= DrawBatch::VERTEX_ARRAY_CHANGED;
+        if ((changes & DrawBatch::PROGRAM_CHANGED) || previous->material != item.material) {
+            changes |= DrawBatch::MATERIAL_CHANGED;
+        }
+
+        // Items sharing this state, i..end
+        size_t end = i + 1;
+        while (end < sorted.size() && sameState(items[sorted[end]], item)) end++;
+
+        size_t multiBegin = i;
+        bool collecting = false;
+        for (size_t j = i; j < end; ) {
+            const DrawItem &first = items[sorted[j]];
+
+            // Same geometry with back to back instance ranges -> one instanced draw
+            GLsizei instances = first.instanceCount;
+            size_t k = j + 1;
+            if (first.instanceOffset >= 0) {
+                while (k < end) {
+                    const DrawItem &next = items[sorted[k]];
+                    if (!sameGeometry(next, first) || next.instance != first.instance + (GLuint)instances) break;
+                    instances += next.instanceCount;
+                    k++;
+                }
+            }
+
+            if (k - j > 1 || instances > 1 || first.instanceOffset >= 0) {
+                if (collecting) addBatch(multiBegin, j, true, 0, 1, changes);
+                collecting = false;
+                addBatch(j, k, false, first.instance, instances, changes);
+            } else if (!collecting) {
+                // Single instance, collect for one multi-draw
+                multiBegin = j;
+                collecting = true;
+            }
+            j = k;
+        }
+        if (collecting) addBatch(multiBegin, end, true, 0, 1, changes);
+
+        previous = &items[sorted[end - 1]];
+        i = end;
+    }
+}
+
+void DrawQueue::addBatch(size_t begin, size_t end, bool multi, GLuint instance, GLsizei instanceCount, unsigned &changes) {
+    DrawBatch batch;
+    batch.begin = (unsigned)begin;
+    batch.end = (unsigned)end;
+    batch.multi = multi;
+    batch.instance = instance;
+    batch.instanceCount = instanceCount;
+    batch.changes = changes;
+    planned.push_back(batch);
+    // Set once, before the first draw of the run
+    changes = 0;
+}
+
+void DrawQueue::execute() {
+    Stats frame = {(int)items.size(), 0, 0, 0, 0, 0};
+    stats = frame;
+    if (items.empty()) return;
+    plan();
+
+    for (size_t b = 0; b < planned.size(); b++) {
+        const DrawBatch &batch = planned[b];
+        const DrawItem &item = items[sorted[batch.begin]];
+
+        if (batch.changes & DrawBatch::PASS_CHANGED) {
+            if (passCallback) passCallback(pass(item.key), passUser);
+            stats.passChanges++;
+        }
+        if (batch.changes & DrawBatch::PROGRAM_CHANGED) {
+            GLState::useProgram(item.program);
+            stats.programChanges++;
+        }
+        if (batch.changes & DrawBatch::VERTEX_ARRAY_CHANGED) {
+            GLState::bindVertexArray(item.vertexArray);
+            stats.vertexArrayChanges++;
+        }
+        if (batch.changes & DrawBatch::MATERIAL_CHANGED) {
+            if (materialCallback) materialCallback(item.material, item.program, materialUser);
+            stats.materialChanges++;
+        }
+
+        if (batch.multi) drawMulti(batch);
+        else drawSingle(item, batch.instance, batch.instanceCount);
+    }
+    items.clear();
+}
+
+void DrawQueue::drawMulti(const DrawBatch &batch) {
+    const DrawItem &state = items[sorted[batch.begin]];
+
+    if (batch.end - batch.begin == 1) {
+        if (state.indexType == GL_NONE) {
+            glDrawArrays(state.mode, (GLint)state.first, state.count);
+        } else {
+            glDrawElementsBaseVertex(state.mode, state.count, state.indexType,
+                                     (const void *)(state.first * indexSize(state.indexType)), state.baseVertex);
+        }
+        stats.drawCalls++;
+        return;
+    }
+
+    multiCounts.clear();
+    multiOffsets.clear();
+    multiFirsts.clear();
+    multiBaseVertices.clear();
+    for (unsigned i = batch.begin; i < batch.end; i++) {
+        const DrawItem &item = items[sorted[i]];
+        if (item.indexType == GL_NONE) {
+            multiFirsts.push_back((GLint)item.first);
+        } else {
+            multiOffsets.push_back((const void *)(item.first * indexSize(item.indexType)));
+            multiBaseVertices.push_back(item.baseVertex);
+        }
+        multiCounts.push_back(item.count);
+    }
+
+    if (state.indexType == GL_NONE) {
+        glMultiDrawArrays(state.mode, &multiFirsts[0], &multiCounts[0], (GLsizei)multiCounts.size());
+    } else {
+        glMultiDrawElementsBaseVertex(state.mode, &multiCounts[0], state.indexType, &multiOffsets[0],
+                                      (GLsizei)multiCounts.size(), &multiBaseVertices[0]);
+    }
+    stats.drawCalls++;
+}
+
+void DrawQueue::drawSingle(const DrawItem &item, GLuint instance, GLsizei instanceCount) {
+    if (item.instanceOffset >= 0) glUniform1i(item.instanceOffset, (GLint)instance);
+    if (item.indexType == GL_NONE) {
+        glDrawArraysInstanced(item.mode, (GLint)item.first, item.count, instanceCount);
+    } else {
+        glDrawElementsInstancedBaseVertex(item.mode, item.count, item.indexType,
+                                          (const void *)(item.first * indexSize(item.indexType)),
+                                          instanceCount, item.baseVertex);
+    }
+    stats.drawCalls++;
+}
+
+bool DrawQueue::sameState(const DrawItem &a, const DrawItem &b) {
+    return pass(a.key) == pass(b.key) && a.program == b.program && a.vertexArray == b.vertexArray && a.material == b.material &&
+           a.mode == b.mode && a.indexType == b.indexType && a.instanceOffset == b.instanceOffset;
+}
+
+bool DrawQueue::sameGeometry(const DrawItem &a, const DrawItem &b) {
+    return a.first == b.first && a.count == b.count && a.baseVertex == b.baseVertex;
+}
@@ -1,4 +1,6 @@
 #include <Engine.hpp>
+#include <stdlib.h>
+#include <chrono>
 
 Engine::Engine() {
   using namespace std;
@@ -6,6 +8,20 @@ Engine::Engine() {
     title = "Untitled Application";
     width = 640;
     height = 480;
+    fixedTimestep = false;
+    updateInterval = 1.0 / 60.0;
+    maxUpdateSteps = 5;
+    previousTime = 0.0;
+    accumulator = 0.0;
+    threadedUpdate = false;
+    jobWorkers = -1;
+    hotReload = true;
+    simulationRunning = false;
+    headless = false;
+    headlessFrames = 1000;
+    headlessFrameTime = 1.0 / 60.0;
+    offscreenFramebuffer = 0;
+    offscreenRenderbuffers[0] = offscreenRenderbuffers[1] = 0;
     cout << "Engine Created" << endl;
 }
 
@@ -18,6 +34,26 @@ static void error_callback(int error, const char* description) {
   fprintf(stderr, "Error %s\n", description);
 }
 
+void Engine::parseArguments(int argc, const char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") headless = true;
+        else if (arg == "--frames" && i + 1 < argc) {
+            // atoi gives 0 for non-numbers, zero or negative frames leave nothing to report
+            int frames = atoi(argv[++i]);
+            if (frames > 0) headlessFrames = frames;
+            else fprintf(stderr, "--frames needs a number above 0, got %s\n", argv[i]);
+        }
+        else if (arg == "--fps" && i + 1 < argc) {
+            // atof gives 0 for non-numbers too, the frame time has to stay finite
+            double fps = atof(argv[++i]);
+            if (fps > 0.0) headlessFrameTime = 1.0 / fps;
+            else fprintf(stderr, "--fps needs a number above 0, got %s\n", argv[i]);
+        }
+        else fprintf(stderr, "Unknown argument %s\n", argv[i]);
+    }
+}
+
 void Engine::init() {
   glfwSetErrorCallback(error_callback);
 }
@@ -49,6 +85,12 @@ void Engine::run(Engine *app) {
     // Don't use old OpenGL
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
+    // Headless still needs a context, keep its window hidden and skip the multisampled backbuffer
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+        glfwWindowHint(GLFW_SAMPLES, 0);
+    }
+
     // Create Window
     this->window = glfwCreateWindow(this->width,
                                     this->height,
@@ -67,9 +109,59 @@ void Engine::run(Engine *app) {
     return -1;
   } */
 
+#ifdef ENGINE_PROFILER
+    profiler.startup();
+#endif
+
+    if (ShaderProgram::enableParallelCompile()) {
+        cout << "Parallel shader compilation available" << endl;
+    }
+
+    jobs.start(jobWorkers);
+    cout << "Job system running on " << jobs.threadCount() << " threads" << endl;
+
+    // Fresh context, nothing is known about its state yet
+    GLState::invalidate();
     startup();
     cout << "Running " << title << " ..." << endl;
 
+    // Simulation thread never touches the GL context
+    if (threadedUpdate) {
+        simulationRunning = true;
+        simulationThread = std::thread(&Engine::simulationLoop, this);
+    }
+
+    if (headless) runHeadless();
+    else runWindowed();
+
+    if (threadedUpdate) {
+        simulationRunning = false;
+        simulationThread.join();
+    }
+
+    // Destruct
+    shutdown();
+    pendingPrograms.clear();
+    watchedPrograms.clear();
+    shaderWatcher.stop();
+    jobs.stop();
+#ifdef ENGINE_PROFILER
+    profiler.shutdown();
+    profiler.dumpCsv("profile.csv");
+    profiler.dumpChromeTrace("profile.json");
+    cout << "Profile written to profile.csv and profile.json" << endl;
+    cout << "GL state calls last frame: " << GLState::lastFrame().issued << " issued, "
+         << GLState::lastFrame().elided << " elided" << endl;
+#endif
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
+
+void Engine::runWindowed() {
+    using namespace std;
+    previousTime = glfwGetTime();
+    accumulator = 0.0;
+
     // Game Loop
     while (!glfwWindowShouldClose(this->window)) {
         if(glfwGetKey(this->window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
@@ -77,15 +169,214 @@ void Engine::run(Engine *app) {
             glfwSetWindowShouldClose(this->window, true);
         }
 
-        render(glfwGetTime());
-        glfwSwapBuffers(this->window);
-        glfwPollEvents();
+#ifdef ENGINE_PROFILER
+        profiler.beginFrame();
+#endif
+        {
+            PROFILE_SCOPE(profiler, "frame");
+            frame(glfwGetTime());
+            GLState::endFrame();
+            {
+                PROFILE_SCOPE(profiler, "swap");
+                glfwSwapBuffers(this->window);
+            }
+            glfwPollEvents();
+        }
+#ifdef ENGINE_PROFILER
+        profiler.endFrame();
+#endif
     }
+}
 
-    // Destruct
-    shutdown();
-    glfwDestroyWindow(window);
-    glfwTerminate();
+void Engine::runHeadless() {
+    using namespace std;
+
+    // Offscreen color + depth target standing in for the window's backbuffer
+    glGenFramebuffers(1, &offscreenFramebuffer);
+    glGenRenderbuffers(2, offscreenRenderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenRenderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenRenderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreenRenderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Offscreen framebuffer incomplete\n");
+    }
+    glViewport(0, 0, width, height);
+
+    // Synthetic clock: frame i always sees i * headlessFrameTime
+    previousTime = 0.0;
+    accumulator = 0.0;
+
+    double minFrame = 1e30;
+    double maxFrame = 0.0;
+    double start = glfwGetTime();
+    for (int i = 0; i < headlessFrames; i++) {
+        double frameStart = glfwGetTime();
+#ifdef ENGINE_PROFILER
+        profiler.beginFrame();
+#endif
+        {
+            PROFILE_SCOPE(profiler, "frame");
+            frame(i * headlessFrameTime);
+            GLState::endFrame();
+            glFlush();
+        }
+#ifdef ENGINE_PROFILER
+        profiler.endFrame();
+#endif
+        double frameTime = glfwGetTime() - frameStart;
+        if (frameTime < minFrame) minFrame = frameTime;
+        if (frameTime > maxFrame) maxFrame = frameTime;
+    }
+    // Wait for the GPU so the total covers all submitted work
+    glFinish();
+    double total = glfwGetTime() - start;
+
+    cout << "Headless report for " << title << endl;
+    cout << "  frames:        " << headlessFrames << " (" << width << "x" << height << ")" << endl;
+    cout << "  total:         " << total * 1000.0 << " ms" << endl;
+    if (headlessFrames > 0) {
+        cout << "  average frame: " << total * 1000.0 / headlessFrames << " ms" << endl;
+        cout << "  cpu min/max:   " << minFrame * 1000.0 << " / " << maxFrame * 1000.0 << " ms" << endl;
+        cout << "  throughput:    " << headlessFrames / total << " frames/s" << endl;
+        cout << "  gl state/frame: " << (double)GLState::total().issued / headlessFrames << " issued, "
+             << (double)GLState::total().elided / headlessFrames << " elided" << endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(2, offscreenRenderbuffers);
+    glDeleteFramebuffers(1, &offscreenFramebuffer);
 }
 
+void Engine::simulationLoop() {
+    using namespace std::chrono;
+    steady_clock::time_point next = steady_clock::now();
+    const steady_clock::duration step = duration_cast<steady_clock::duration>(duration<double>(updateInterval));
+
+    while (simulationRunning) {
+        // Catch up at most maxUpdateSteps, then resync with the clock
+        int steps = 0;
+        while (steady_clock::now() >= next && steps < maxUpdateSteps) {
+            update(updateInterval);
+            next += step;
+            steps++;
+        }
+        if (steps == maxUpdateSteps) next = steady_clock::now() + step;
+
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Engine::compileAsync(ShaderProgram &program, const ShaderStage *stages, int count) {
+    program.submit(stages, count, &shaderCache);
+    if (!program.poll()) pendingPrograms.push_back(&program);
+}
+
+bool Engine::loadProgram(ShaderProgram &program, const ShaderFile *files, int count) {
+    WatchedProgram watched;
+    watched.program = &program;
+    for (int i = 0; i < count; i++) {
+        watched.types.push_back(files[i].type);
+        watched.paths.push_back(files[i].path);
+    }
+
+    bool built = buildFromFiles(program, watched);
+    if (hotReload) {
+        for (int i = 0; i < count; i++) shaderWatcher.watch(files[i].path);
+        watchedPrograms.push_back(watched);
+    }
+    return built;
+}
+
+bool Engine::buildFromFiles(ShaderProgram &program, const WatchedProgram &watched) {
+    std::vector<std::string> sources(watched.paths.size());
+    std::vector<ShaderStage> stages(watched.paths.size());
+    for (size_t i = 0; i < watched.paths.size(); i++) {
+        if (!ShaderProgram::readSource(watched.paths[i], sources[i])) return false;
+        stages[i].type = watched.types[i];
+        stages[i].source = sources[i].c_str();
+    }
+    return program.build(&stages[0], (int)stages.size(), &shaderCache);
+}
+
+void Engine::reloadChangedShaders() {
+    std::vector<std::string> changed;
+    if (!shaderWatcher.takeChanged(changed)) return;
+
+    for (size_t i = 0; i < watchedPrograms.size(); i++) {
+        const WatchedProgram &watched = watchedPrograms[i];
+        bool affected = false;
+        for (size_t c = 0; c < changed.size() && !affected; c++) {
+            for (size_t p = 0; p < watched.paths.size(); p++) {
+                if (watched.paths[p] == changed[c]) affected = true;
+            }
+        }
+        if (!affected) continue;
+
+        // Build next to the old program, only swap when it worked
+        ShaderProgram rebuilt;
+        if (buildFromFiles(rebuilt, watched)) {
+            watched.program->swap(rebuilt);
+            std::cout << "Reloaded " << watched.paths[0] << " (+" << watched.paths.size() - 1 << " files)" << std::endl;
+        } else {
+            std::cout << "Reload failed, keeping the previous program" << std::endl;
+        }
+        rebuilt.destroy();
+    }
+}
+
+void Engine::frame(double currentTime) {
+    if (hotReload) reloadChangedShaders();
+
+    // Pick up programs the driver finished since last frame
+    for (size_t i = 0; i < pendingPrograms.size(); ) {
+        if (pendingPrograms[i]->poll()) {
+            pendingPrograms[i] = pendingPrograms.back();
+            pendingPrograms.pop_back();
+        } else {
+            i++;
+        }
+    }
+
+    if (!fixedTimestep || threadedUpdate) {
+        PROFILE_SCOPE(profiler, "render");
+        PROFILE_GPU_SCOPE(profiler, "render");
+        render(currentTime);
+        drawQueue.execute();
+        return;
+    }
+
+    accumulator += currentTime - previousTime;
+    previousTime = currentTime;
+
+    // Run 0..maxUpdateSteps simulation steps to catch up with the clock
+    int steps = 0;
+    while (accumulator >= updateInterval && steps < maxUpdateSteps) {
+        PROFILE_SCOPE(profiler, "update");
+        update(updateInterval);
+        accumulator -= updateInterval;
+        steps++;
+    }
+
+    // Too far behind, drop the backlog instead of slowing down further
+    if (accumulator >= updateInterval) {
+        accumulator = fmod(accumulator, updateInterval);
+    }
+
+    // Blend factor between the previous and current simulation state
+    PROFILE_SCOPE(profiler, "render");
+    PROFILE_GPU_SCOPE(profiler, "render");
+    render(currentTime, accumulator / updateInterval);
+    drawQueue.execute();
+}
+
+void Engine::update(double dt) {}
+
 void Engine::render(double currentTime){}
+
+void Engine::render(double currentTime, double alpha) {
+    render(currentTime);
+}
@@ -0,0 +1,192 @@
+#include <GLState.hpp>
+
+// Never a valid name or enum, so the first call after invalidate() always goes through
+static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+GLState::State GLState::state;
+GLState::Stats GLState::current = {0, 0};
+GLState::Stats GLState::previous = {0, 0};
+GLState::Stats GLState::overall = {0, 0};
+
+void GLState::invalidate() {
+    state.program = UNKNOWN;
+    state.vertexArray = UNKNOWN;
+    for (int i = 0; i < BUFFER_TARGETS; i++) state.buffers[i] = UNKNOWN;
+    state.activeUnit = UNKNOWN;
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+        for (int i = 0; i < TEXTURE_TARGETS; i++) state.textures[unit][i] = UNKNOWN;
+    }
+    for (int i = 0; i < CAPABILITIES; i++) state.capabilities[i] = -1;
+    state.blendSource = UNKNOWN;
+    state.blendDestination = UNKNOWN;
+    state.blendMode = UNKNOWN;
+    state.depthFunction = UNKNOWN;
+    state.depthWrite = -1;
+    state.polygon = UNKNOWN;
+}
+
+void GLState::useProgram(GLuint program) {
+    if (state.program == program) return elided();
+    glUseProgram(program);
+    state.program = program;
+    issued();
+}
+
+void GLState::bindVertexArray(GLuint vertexArray) {
+    if (state.vertexArray == vertexArray) return elided();
+    glBindVertexArray(vertexArray);
+    state.vertexArray = vertexArray;
+    // The element buffer binding is part of the VAO
+    state.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    issued();
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+    int slot = bufferSlot(target);
+    if (slot >= 0 && state.buffers[slot] == buffer) return elided();
+    glBindBuffer(target, buffer);
+    if (slot >= 0) state.buffers[slot] = buffer;
+    issued();
+}
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+    int slot = textureSlot(target);
+    if (slot >= 0 && unit < (GLuint)MAX_TEXTURE_UNITS && state.textures[unit][slot] == texture) return elided();
+    if (state.activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        state.activeUnit = unit;
+        issued();
+    }
+    glBindTexture(target, texture);
+    if (slot >= 0 && unit < (GLuint)MAX_TEXTURE_UNITS) state.textures[unit][slot] = texture;
+    issued();
+}
+
+void GLState::enable(GLenum capability) {
+    setCapability(capability, true);
+}
+
+void GLState::disable(GLenum capability) {
+    setCapability(capability, false);
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination) {
+    if (state.blendSource == source && state.blendDestination == destination) return elided();
+    glBlendFunc(source, destination);
+    state.blendSource = source;
+    state.blendDestination = destination;
+    issued();
+}
+
+void GLState::blendEquation(GLenum mode) {
+    if (state.blendMode == mode) return elided();
+    glBlendEquation(mode);
+    state.blendMode = mode;
+    issued();
+}
+
+void GLState::depthFunc(GLenum function) {
+    if (state.depthFunction == function) return elided();
+    glDepthFunc(function);
+    state.depthFunction = function;
+    issued();
+}
+
+void GLState::depthMask(GLboolean mask) {
+    int write = mask ? 1 : 0;
+    if (state.depthWrite == write) return elided();
+    glDepthMask(mask);
+    state.depthWrite = write;
+    issued();
+}
+
+void GLState::polygonMode(GLenum mode) {
+    if (state.polygon == mode) return elided();
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+    state.polygon = mode;
+    issued();
+}
+
+void GLState::programDeleted(GLuint program) {
+    // GL keeps a deleted program alive while it's current, the id can come back afterwards
+    if (state.program == program) state.program = UNKNOWN;
+}
+
+void GLState::vertexArrayDeleted(GLuint vertexArray) {
+    // Deleting the bound VAO reverts the binding to 0
+    if (state.vertexArray == vertexArray) {
+        state.vertexArray = 0;
+        state.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    }
+}
+
+void GLState::bufferDeleted(GLuint buffer) {
+    for (int i = 0; i < BUFFER_TARGETS; i++) {
+        if (state.buffers[i] == buffer) state.buffers[i] = 0;
+    }
+}
+
+void GLState::textureDeleted(GLuint texture) {
+    // GL unbinds a deleted texture from every unit
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+        for (int i = 0; i < TEXTURE_TARGETS; i++) {
+            if (state.textures[unit][i] == texture) state.textures[unit][i] = 0;
+        }
+    }
+}
+
+void GLState::endFrame() {
+    previous = current;
+    current.issued = 0;
+    current.elided = 0;
+}
+
+int GLState::bufferSlot(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_COPY_READ_BUFFER: return 3;
+        case GL_COPY_WRITE_BUFFER: return 4;
+        case GL_PIXEL_UNPACK_BUFFER: return 5;
+        case GL_PIXEL_PACK_BUFFER: return 6;
+        case GL_TEXTURE_BUFFER: return 7;
+        case GL_DRAW_INDIRECT_BUFFER: return 8;
+        default: return -1;  // not shadowed, always issued
+    }
+}
+
+int GLState::textureSlot(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_3D: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+        case GL_TEXTURE_2D_ARRAY: return 3;
+        case GL_TEXTURE_BUFFER: return 4;
+        case GL_TEXTURE_1D: return 5;
+        default: return -1;
+    }
+}
+
+int GLState::capabilitySlot(GLenum capability) {
+    switch (capability) {
+        case GL_BLEND: return 0;
+        case GL_DEPTH_TEST: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_SCISSOR_TEST: return 3;
+        case GL_STENCIL_TEST: return 4;
+        case GL_PROGRAM_POINT_SIZE: return 5;
+        case GL_MULTISAMPLE: return 6;
+        case GL_RASTERIZER_DISCARD: return 7;
+        default: return -1;
+    }
+}
+
+void GLState::setCapability(GLenum capability, bool enabled) {
+    int slot = capabilitySlot(capability);
+    if (slot >= 0 && state.capabilities[slot] == (enabled ? 1 : 0)) return elided();
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+    if (slot >= 0) state.capabilities[slot] = enabled ? 1 : 0;
+    issued();
+}
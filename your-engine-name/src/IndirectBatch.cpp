@@ -0,0 +1,120 @@
+#include <IndirectBatch.hpp>
+#include <GLState.hpp>
+#include <GLFW/glfw3.h>
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+static size_t indexSize(GLenum type) {
+    switch (type) {
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        default: return 4;
+    }
+}
+
+IndirectBatch::IndirectBatch() {
+    apiCalls = 0;
+    current.pointer = NULL;
+    currentCount = 0;
+    frameStarted = false;
+    drawIds = 0;
+    attachedIndex = 0;
+    maxDraws = 0;
+    multiDraw = NULL;
+}
+
+IndirectBatch::~IndirectBatch() {
+    destroy();
+}
+
+bool IndirectBatch::create(int draws, bool allowMultiDraw) {
+    destroy();
+    if (draws < 1) return false;
+    maxDraws = draws;
+
+    // base instance in indirect commands needs ARB_base_instance too (both core in 4.3)
+    if (allowMultiDraw && glfwExtensionSupported("GL_ARB_multi_draw_indirect") &&
+        glfwExtensionSupported("GL_ARB_base_instance")) {
+        multiDraw = (MultiDrawElementsIndirectFunction)glfwGetProcAddress("glMultiDrawElementsIndirect");
+    }
+
+    std::vector<GLuint> ids(draws);
+    for (int i = 0; i < draws; i++) ids[i] = (GLuint)i;
+    glGenBuffers(1, &drawIds);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, drawIds);
+    glBufferData(GL_ARRAY_BUFFER, draws * sizeof(GLuint), &ids[0], GL_STATIC_DRAW);
+
+    // The fallback never reads commands on the GPU, plain memory is enough
+    if (!multiDraw) {
+        fallbackCommands.resize(draws);
+        return true;
+    }
+    return commands.create(GL_DRAW_INDIRECT_BUFFER, draws * sizeof(DrawElementsIndirectCommand));
+}
+
+void IndirectBatch::destroy() {
+    commands.destroy();
+    if (drawIds) {
+        glDeleteBuffers(1, &drawIds);
+        GLState::bufferDeleted(drawIds);
+    }
+    drawIds = 0;
+    multiDraw = NULL;
+    fallbackCommands.clear();
+    maxDraws = 0;
+    currentCount = 0;
+    frameStarted = false;
+}
+
+void IndirectBatch::attach(GLuint vao, GLuint index) {
+    attachedIndex = index;
+    GLState::bindVertexArray(vao);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, drawIds);
+    glEnableVertexAttribArray(index);
+    glVertexAttribIPointer(index, 1, GL_UNSIGNED_INT, 0, (const void *)0);
+    glVertexAttribDivisor(index, 1);
+}
+
+DrawElementsIndirectCommand *IndirectBatch::begin(int count) {
+    currentCount = 0;
+    if (count > maxDraws) return NULL;
+    currentCount = count;
+    if (!multiDraw) return fallbackCommands.empty() ? NULL : &fallbackCommands[0];
+
+    if (!frameStarted) commands.beginFrame();
+    frameStarted = true;
+    current = commands.allocate(count * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+    return (DrawElementsIndirectCommand *)current.pointer;
+}
+
+void IndirectBatch::submit(GLenum mode, GLenum indexType) {
+    if (multiDraw) {
+        if (current.valid() && currentCount) {
+            commands.flush();
+            GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.id());
+            multiDraw(mode, indexType, (const void *)current.offset, currentCount, 0);
+            apiCalls++;
+        }
+        // Only fence a frame begin() started, a second fence would replace one nobody waited on
+        if (frameStarted) commands.endFrame();
+        frameStarted = false;
+        current.pointer = NULL;
+    } else if (currentCount) {
+        // No multi-draw, same result one command at a time
+        const DrawElementsIndirectCommand *list = &fallbackCommands[0];
+        GLState::bindBuffer(GL_ARRAY_BUFFER, drawIds);
+        for (int i = 0; i < currentCount; i++) {
+            const DrawElementsIndirectCommand &c = list[i];
+            if (!c.count || !c.instanceCount) continue;
+            glVertexAttribIPointer(attachedIndex, 1, GL_UNSIGNED_INT, 0, (const void *)(c.baseInstance * sizeof(GLuint)));
+            glDrawElementsInstancedBaseVertex(mode, c.count, indexType, (const void *)(c.firstIndex * indexSize(indexType)),
+                                              c.instanceCount, c.baseVertex);
+            apiCalls++;
+        }
+        // Leave the attribute where attach() put it
+        glVertexAttribIPointer(attachedIndex, 1, GL_UNSIGNED_INT, 0, (const void *)0);
+    }
+    currentCount = 0;
+}
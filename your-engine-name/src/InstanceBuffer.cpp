@@ -0,0 +1,89 @@
+#include <InstanceBuffer.hpp>
+#include <GLState.hpp>
+
+static size_t indexSize(GLenum type) {
+    switch (type) {
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        default: return 4;
+    }
+}
+
+InstanceBuffer::InstanceBuffer() {
+    current.pointer = NULL;
+    instanceStride = 0;
+    vao = 0;
+    maxInstances = 0;
+    count = 0;
+    pointedAt = -1;
+}
+
+bool InstanceBuffer::create(const VertexAttribute *attributeList, int attributeCount, GLsizei stride, int instances) {
+    attributes.assign(attributeList, attributeList + attributeCount);
+    instanceStride = stride;
+    maxInstances = instances;
+    // Slack for the per-allocation alignment
+    return stream.create(GL_ARRAY_BUFFER, (GLsizeiptr)stride * instances + 16);
+}
+
+void InstanceBuffer::destroy() {
+    stream.destroy();
+    attributes.clear();
+    vao = 0;
+}
+
+void InstanceBuffer::attach(GLuint vertexArray) {
+    vao = vertexArray;
+    GLState::bindVertexArray(vao);
+    for (size_t i = 0; i < attributes.size(); i++) {
+        glEnableVertexAttribArray(attributes[i].index);
+        glVertexAttribDivisor(attributes[i].index, 1);
+    }
+    pointedAt = -1;
+}
+
+void *InstanceBuffer::begin(int instances) {
+    // Frame starts even when the request is too big, end() always fences what beginFrame() waited on
+    stream.beginFrame();
+    if (instances > maxInstances) {
+        current.pointer = NULL;
+        count = 0;
+        return NULL;
+    }
+    current = stream.allocate((GLsizeiptr)instances * instanceStride, 16);
+    count = current.valid() ? instances : 0;
+    return current.pointer;
+}
+
+// Attribute pointers follow the ring, one glVertexAttribPointer per attribute when the slice moved
+void InstanceBuffer::point() {
+    stream.flush();
+    GLState::bindVertexArray(vao);
+    if (pointedAt == current.offset) return;
+    GLState::bindBuffer(GL_ARRAY_BUFFER, stream.id());
+    for (size_t i = 0; i < attributes.size(); i++) {
+        const VertexAttribute &a = attributes[i];
+        glVertexAttribPointer(a.index, a.size, a.type, a.normalized, instanceStride,
+                              (const void *)(current.offset + a.offset));
+    }
+    pointedAt = current.offset;
+}
+
+void InstanceBuffer::drawArrays(GLenum mode, GLint first, GLsizei vertexCount) {
+    if (!count) return;
+    point();
+    glDrawArraysInstanced(mode, first, vertexCount, count);
+}
+
+void InstanceBuffer::drawElements(GLenum mode, GLsizei indexCount, GLenum indexType, GLuint firstIndex, GLint baseVertex) {
+    if (!count) return;
+    point();
+    glDrawElementsInstancedBaseVertex(mode, indexCount, indexType, (const void *)(firstIndex * indexSize(indexType)),
+                                      count, baseVertex);
+}
+
+void InstanceBuffer::end() {
+    stream.endFrame();
+    current.pointer = NULL;
+    count = 0;
+}
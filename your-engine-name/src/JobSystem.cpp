@@ -0,0 +1,246 @@
+#include <JobSystem.hpp>
+
+// Which system/worker the current thread belongs to
+static thread_local const JobSystem *currentSystem = NULL;
+static thread_local int currentIndex = -1;
+
+void JobQueue::Slot::store(const Job &job) {
+    function.store(job.function, std::memory_order_relaxed);
+    data.store(job.data, std::memory_order_relaxed);
+    begin.store(job.begin, std::memory_order_relaxed);
+    end.store(job.end, std::memory_order_relaxed);
+    counter.store(job.counter, std::memory_order_relaxed);
+    dependency.store(job.dependency, std::memory_order_relaxed);
+}
+
+void JobQueue::Slot::load(Job &job) const {
+    job.function = function.load(std::memory_order_relaxed);
+    job.data = data.load(std::memory_order_relaxed);
+    job.begin = begin.load(std::memory_order_relaxed);
+    job.end = end.load(std::memory_order_relaxed);
+    job.counter = counter.load(std::memory_order_relaxed);
+    job.dependency = dependency.load(std::memory_order_relaxed);
+}
+
+bool JobQueue::push(const Job &job) {
+    long long b = bottom.load(std::memory_order_relaxed);
+    long long t = top.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY) return false;
+
+    jobs[b & (CAPACITY - 1)].store(job);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobQueue::pop(Job &job) {
+    long long b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // Empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    jobs[b & (CAPACITY - 1)].load(job);
+    if (t == b) {
+        // Last job, race the thieves for it
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool JobQueue::steal(Job &job) {
+    long long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long b = bottom.load(std::memory_order_acquire);
+    if (t >= b) return false;
+
+    // Copy first: once top moves on, the owner may refill this slot
+    jobs[t & (CAPACITY - 1)].load(job);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+JobSystem::JobSystem() {
+    pendingJobs = 0;
+    sleepers = 0;
+    running = false;
+}
+
+JobSystem::~JobSystem() {
+    stop();
+}
+
+void JobSystem::start(int workerCount) {
+    if (running) return;
+    if (workerCount < 0) {
+        int hardwareThreads = (int)std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    for (int i = 0; i <= workerCount; i++) {
+        queues.push_back(new JobQueue());
+    }
+
+    // Calling thread is worker 0
+    currentSystem = this;
+    currentIndex = 0;
+
+    running = true;
+    for (int i = 1; i <= workerCount; i++) {
+        threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+    }
+}
+
+void JobSystem::stop() {
+    if (!running) return;
+
+    running = false;
+    {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        wakeUp.notify_all();
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    threads.clear();
+
+    for (size_t i = 0; i < queues.size(); i++) {
+        delete queues[i];
+    }
+    queues.clear();
+    injected.clear();
+    pendingJobs = 0;
+
+    if (currentSystem == this) {
+        currentSystem = NULL;
+        currentIndex = -1;
+    }
+}
+
+int JobSystem::currentWorker() const {
+    return currentSystem == this ? currentIndex : -1;
+}
+
+void JobSystem::run(JobFunction function, void *data, int begin, int end,
+                    JobCounter *counter, JobCounter *dependency) {
+    Job job;
+    job.function = function;
+    job.data = data;
+    job.begin = begin;
+    job.end = end;
+    job.counter = counter;
+    job.dependency = dependency;
+
+    if (counter) counter->value.fetch_add(1, std::memory_order_relaxed);
+
+    // Not started, just do the work right here
+    if (!running) {
+        if (dependency) wait(dependency);
+        function(data, begin, end);
+        if (counter) counter->value.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    push(job);
+}
+
+void JobSystem::push(const Job &job) {
+    int worker = currentWorker();
+    if (worker >= 0) {
+        if (!queues[worker]->push(job)) {
+            // Deque full, run it ourselves
+            if (job.dependency) wait(job.dependency);
+            job.function(job.data, job.begin, job.end);
+            if (job.counter) job.counter->value.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(injectedLock);
+        injected.push_back(job);
+    }
+
+    pendingJobs.fetch_add(1);
+    if (sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        wakeUp.notify_one();
+    }
+}
+
+bool JobSystem::execute(int worker) {
+    Job job;
+    bool found = false;
+
+    // Own deque first, then jobs from outside threads, then steal
+    if (worker >= 0) found = queues[worker]->pop(job);
+    if (!found) {
+        std::lock_guard<std::mutex> lock(injectedLock);
+        if (!injected.empty()) {
+            job = injected.front();
+            injected.pop_front();
+            found = true;
+        }
+    }
+    if (!found) {
+        int count = (int)queues.size();
+        for (int i = 1; i <= count && !found; i++) {
+            int victim = (worker + i + count) % count;
+            if (victim == worker) continue;
+            found = queues[victim]->steal(job);
+        }
+    }
+    if (!found) return false;
+    pendingJobs.fetch_sub(1);
+
+    // Dependency still running -> park it at the back of the shared queue. Back on our own deque the
+    // next pop() would hand it right back and the job it waits for (below it) would never run.
+    if (job.dependency && !job.dependency->done()) {
+        {
+            std::lock_guard<std::mutex> lock(injectedLock);
+            injected.push_back(job);
+        }
+        pendingJobs.fetch_add(1);
+        std::this_thread::yield();
+        return true;
+    }
+
+    job.function(job.data, job.begin, job.end);
+    if (job.counter) job.counter->value.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::wait(JobCounter *counter) {
+    int worker = currentWorker();
+    while (!counter->done()) {
+        if (!execute(worker)) std::this_thread::yield();
+    }
+}
+
+void JobSystem::workerLoop(int worker) {
+    currentSystem = this;
+    currentIndex = worker;
+
+    int idle = 0;
+    while (running) {
+        if (execute(worker)) {
+            idle = 0;
+            continue;
+        }
+
+        // Spin a little before going to sleep
+        if (++idle < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+        idle = 0;
+
+        std::unique_lock<std::mutex> lock(sleepLock);
+        sleepers.fetch_add(1);
+        wakeUp.wait(lock, [this] { return pendingJobs.load() > 0 || !running; });
+        sleepers.fetch_sub(1);
+    }
+}
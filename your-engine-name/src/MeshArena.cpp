@@ -0,0 +1,189 @@
+#include <MeshArena.hpp>
+#include <GLState.hpp>
+
+MeshArena::MeshArena() {
+    stride = 0;
+    vao = 0;
+    vbo = 0;
+    ibo = 0;
+}
+
+MeshArena::~MeshArena() {
+    destroy();
+}
+
+bool MeshArena::create(const VertexAttribute *attributeList, int attributeCount, GLsizei vertexStride,
+                       GLuint vertexCapacity, GLuint indexCapacity) {
+    destroy();
+    attributes.assign(attributeList, attributeList + attributeCount);
+    stride = vertexStride;
+
+    vertices.reset(vertexCapacity);
+    indices.reset(indexCapacity);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    attach();
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * stride, NULL, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+    return vao != 0;
+}
+
+void MeshArena::destroy() {
+    if (vao) {
+        glDeleteVertexArrays(1, &vao);
+        GLState::vertexArrayDeleted(vao);
+    }
+    if (vbo) {
+        glDeleteBuffers(1, &vbo);
+        GLState::bufferDeleted(vbo);
+    }
+    if (ibo) {
+        glDeleteBuffers(1, &ibo);
+        GLState::bufferDeleted(ibo);
+    }
+    vao = vbo = ibo = 0;
+    meshes.clear();
+    freeMeshes.clear();
+}
+
+unsigned MeshArena::add(const void *vertexData, GLuint vertexCount, const GLuint *indexData, GLuint indexCount) {
+    unsigned vertexBlock = vertices.allocate(vertexCount);
+    unsigned indexBlock = indices.allocate(indexCount);
+
+    if (vertexBlock == RangeAllocator::INVALID || indexBlock == RangeAllocator::INVALID) {
+        vertices.free(vertexBlock);
+        indices.free(indexBlock);
+
+        // Pack what's there and leave room for at least twice the mesh, then retry once
+        GLuint vertexCapacity = vertices.capacity();
+        GLuint indexCapacity = indices.capacity();
+        while (vertexCapacity < vertices.used() + vertexCount * 2) vertexCapacity = vertexCapacity ? vertexCapacity * 2 : 1024;
+        while (indexCapacity < indices.used() + indexCount * 2) indexCapacity = indexCapacity ? indexCapacity * 2 : 1024;
+        rebuild(vertexCapacity, indexCapacity);
+
+        vertexBlock = vertices.allocate(vertexCount);
+        indexBlock = indices.allocate(indexCount);
+        if (vertexBlock == RangeAllocator::INVALID || indexBlock == RangeAllocator::INVALID) {
+            vertices.free(vertexBlock);
+            indices.free(indexBlock);
+            return INVALID;
+        }
+    }
+
+    unsigned mesh;
+    if (!freeMeshes.empty()) {
+        mesh = freeMeshes.back();
+        freeMeshes.pop_back();
+    } else {
+        mesh = (unsigned)meshes.size();
+        meshes.push_back(Mesh());
+    }
+    Mesh &m = meshes[mesh];
+    m.vertexBlock = vertexBlock;
+    m.indexBlock = indexBlock;
+    m.range.baseVertex = (GLint)vertices.offset(vertexBlock);
+    m.range.firstIndex = indices.offset(indexBlock);
+    m.range.vertexCount = vertexCount;
+    m.range.indexCount = indexCount;
+    m.live = true;
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)m.range.baseVertex * stride, (GLsizeiptr)vertexCount * stride, vertexData);
+    // The element buffer binding belongs to the VAO
+    GLState::bindVertexArray(vao);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)m.range.firstIndex * sizeof(GLuint),
+                    (GLsizeiptr)indexCount * sizeof(GLuint), indexData);
+    return mesh;
+}
+
+void MeshArena::remove(unsigned mesh) {
+    if (mesh >= meshes.size() || !meshes[mesh].live) return;
+    vertices.free(meshes[mesh].vertexBlock);
+    indices.free(meshes[mesh].indexBlock);
+    meshes[mesh].live = false;
+    freeMeshes.push_back(mesh);
+}
+
+void MeshArena::defragment() {
+    rebuild(vertices.capacity(), indices.capacity());
+}
+
+void MeshArena::bind() const {
+    GLState::bindVertexArray(vao);
+}
+
+void MeshArena::draw(unsigned mesh, GLenum mode) const {
+    const MeshRange &r = meshes[mesh].range;
+    glDrawElementsBaseVertex(mode, r.indexCount, GL_UNSIGNED_INT,
+                             (const void *)(r.firstIndex * sizeof(GLuint)), r.baseVertex);
+}
+
+float MeshArena::vertexFragmentation() const {
+    return fragmentation(vertices);
+}
+
+float MeshArena::indexFragmentation() const {
+    return fragmentation(indices);
+}
+
+// New buffers, live meshes copied over GPU side (glCopyBufferSubData), packed to the front
+void MeshArena::rebuild(GLuint vertexCapacity, GLuint indexCapacity) {
+    GLuint newBuffers[2];
+    glGenBuffers(2, newBuffers);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, newBuffers[0]);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertexCapacity * stride, NULL, GL_STATIC_DRAW);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, newBuffers[1]);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+    vertices.reset(vertexCapacity);
+    indices.reset(indexCapacity);
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        Mesh &m = meshes[i];
+        if (!m.live) continue;
+        m.vertexBlock = vertices.allocate(m.range.vertexCount);
+        m.indexBlock = indices.allocate(m.range.indexCount);
+        GLint baseVertex = (GLint)vertices.offset(m.vertexBlock);
+        GLuint firstIndex = indices.offset(m.indexBlock);
+
+        GLState::bindBuffer(GL_COPY_READ_BUFFER, vbo);
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, newBuffers[0]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)m.range.baseVertex * stride,
+                            (GLintptr)baseVertex * stride, (GLsizeiptr)m.range.vertexCount * stride);
+        GLState::bindBuffer(GL_COPY_READ_BUFFER, ibo);
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, newBuffers[1]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)m.range.firstIndex * sizeof(GLuint),
+                            (GLintptr)firstIndex * sizeof(GLuint), (GLsizeiptr)m.range.indexCount * sizeof(GLuint));
+
+        m.range.baseVertex = baseVertex;
+        m.range.firstIndex = firstIndex;
+    }
+
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    GLState::bufferDeleted(vbo);
+    GLState::bufferDeleted(ibo);
+    vbo = newBuffers[0];
+    ibo = newBuffers[1];
+    attach();
+}
+
+void MeshArena::attach() {
+    GLState::bindVertexArray(vao);
+    GLState::bindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    for (size_t i = 0; i < attributes.size(); i++) {
+        const VertexAttribute &a = attributes[i];
+        glEnableVertexAttribArray(a.index);
+        glVertexAttribPointer(a.index, a.size, a.type, a.normalized, stride, (const void *)a.offset);
+    }
+}
+
+// 0 = all free space in one block, close to 1 = free space scattered in small holes
+float MeshArena::fragmentation(const RangeAllocator &allocator) {
+    unsigned free = allocator.capacity() - allocator.used();
+    if (!free) return 0.0f;
+    return 1.0f - (float)allocator.largestFree() / (float)free;
+}
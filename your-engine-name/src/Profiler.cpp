@@ -0,0 +1,241 @@
+#include <Profiler.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+static std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+
+Profiler::Profiler() {
+    frames = new Frame[HISTORY_FRAMES];
+    cpuEvents = new Event[HISTORY_FRAMES * MAX_SCOPES];
+    gpuEvents = new Event[HISTORY_FRAMES * MAX_GPU_SCOPES];
+    queries = new GLuint[FRAME_LATENCY * MAX_GPU_SCOPES * 2];
+    for (int i = 0; i < HISTORY_FRAMES; i++) {
+        frames[i].number = -1;
+        frames[i].cpuCount = 0;
+        frames[i].gpuCount = 0;
+        frames[i].gpuResolved = false;
+    }
+    frameNumber = -1;
+    stackSize = 0;
+    queriesReady = false;
+    gpuOffset = 0.0;
+}
+
+Profiler::~Profiler() {
+    delete[] frames;
+    delete[] cpuEvents;
+    delete[] gpuEvents;
+    delete[] queries;
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+void Profiler::startup() {
+    glGenQueries(FRAME_LATENCY * MAX_GPU_SCOPES * 2, queries);
+    queriesReady = true;
+
+    // Remember where the GPU clock sits relative to ours
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    gpuOffset = gpuTime * 1e-9 - now();
+}
+
+void Profiler::shutdown() {
+    if (!queriesReady) return;
+
+    // Collect what is still in flight, we are allowed to wait now
+    for (long long n = frameNumber - FRAME_LATENCY + 1; n <= frameNumber; n++) {
+        if (n >= 0) resolveGpu(n, true);
+    }
+    glDeleteQueries(FRAME_LATENCY * MAX_GPU_SCOPES * 2, queries);
+    queriesReady = false;
+}
+
+void Profiler::beginFrame() {
+    frameNumber++;
+
+    // The query slot we are about to reuse belongs to FRAME_LATENCY frames ago
+    if (queriesReady && frameNumber >= FRAME_LATENCY) {
+        resolveGpu(frameNumber - FRAME_LATENCY, false);
+    }
+
+    Frame &frame = currentFrame();
+    frame.number = frameNumber;
+    frame.cpuCount = 0;
+    frame.gpuCount = 0;
+    frame.gpuResolved = false;
+    stackSize = 0;
+}
+
+void Profiler::endFrame() {
+    // Close anything left open so the frame stays well formed
+    while (stackSize > 0) {
+        endCpu(stack[stackSize - 1]);
+    }
+}
+
+int Profiler::beginCpu(const char *name) {
+    if (frameNumber < 0) return -1;
+    Frame &frame = currentFrame();
+    if (frame.cpuCount >= MAX_SCOPES || stackSize >= MAX_DEPTH) return -1;
+
+    int index = frame.cpuCount++;
+    Event &event = cpuEvents[(frameNumber % HISTORY_FRAMES) * MAX_SCOPES + index];
+    event.name = name;
+    event.depth = stackSize;
+    event.start = now();
+    event.end = event.start;
+    stack[stackSize++] = index;
+    return index;
+}
+
+void Profiler::endCpu(int index) {
+    if (index < 0) return;
+    cpuEvents[(frameNumber % HISTORY_FRAMES) * MAX_SCOPES + index].end = now();
+    if (stackSize > 0 && stack[stackSize - 1] == index) stackSize--;
+}
+
+int Profiler::beginGpu(const char *name) {
+    if (!queriesReady || frameNumber < 0) return -1;
+    Frame &frame = currentFrame();
+    if (frame.gpuCount >= MAX_GPU_SCOPES) return -1;
+
+    int index = frame.gpuCount++;
+    Event &event = gpuEvents[(frameNumber % HISTORY_FRAMES) * MAX_GPU_SCOPES + index];
+    event.name = name;
+    event.depth = 0;
+    event.start = 0.0;
+    event.end = 0.0;
+
+    int slot = (frameNumber % FRAME_LATENCY) * MAX_GPU_SCOPES + index;
+    glQueryCounter(queries[slot * 2], GL_TIMESTAMP);
+    return index;
+}
+
+void Profiler::endGpu(int index) {
+    if (index < 0) return;
+    int slot = (frameNumber % FRAME_LATENCY) * MAX_GPU_SCOPES + index;
+    glQueryCounter(queries[slot * 2 + 1], GL_TIMESTAMP);
+}
+
+void Profiler::resolveGpu(long long number, bool wait) {
+    Frame &frame = frames[number % HISTORY_FRAMES];
+    if (frame.number != number || frame.gpuResolved || frame.gpuCount == 0) return;
+
+    // Still not done after FRAME_LATENCY frames -> drop it rather than stall
+    if (!wait) {
+        int last = (number % FRAME_LATENCY) * MAX_GPU_SCOPES + frame.gpuCount - 1;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[last * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            frame.gpuCount = 0;
+            return;
+        }
+    }
+    frame.gpuResolved = true;
+
+    for (int i = 0; i < frame.gpuCount; i++) {
+        int slot = (number % FRAME_LATENCY) * MAX_GPU_SCOPES + i;
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(queries[slot * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[slot * 2 + 1], GL_QUERY_RESULT, &end);
+
+        Event &event = gpuEvents[(number % HISTORY_FRAMES) * MAX_GPU_SCOPES + i];
+        event.start = start * 1e-9 - gpuOffset;
+        event.end = end * 1e-9 - gpuOffset;
+    }
+}
+
+double Profiler::averageCpu(const char *name) const {
+    double total = 0.0;
+    int count = 0;
+    for (int f = 0; f < HISTORY_FRAMES; f++) {
+        if (frames[f].number < 0) continue;
+        for (int i = 0; i < frames[f].cpuCount; i++) {
+            const Event &event = cpuEvents[f * MAX_SCOPES + i];
+            if (strcmp(event.name, name) == 0) {
+                total += event.end - event.start;
+                count++;
+            }
+        }
+    }
+    return count ? total * 1000.0 / count : 0.0;
+}
+
+double Profiler::averageGpu(const char *name) const {
+    double total = 0.0;
+    int count = 0;
+    for (int f = 0; f < HISTORY_FRAMES; f++) {
+        if (frames[f].number < 0 || !frames[f].gpuResolved) continue;
+        for (int i = 0; i < frames[f].gpuCount; i++) {
+            const Event &event = gpuEvents[f * MAX_GPU_SCOPES + i];
+            if (strcmp(event.name, name) == 0) {
+                total += event.end - event.start;
+                count++;
+            }
+        }
+    }
+    return count ? total * 1000.0 / count : 0.0;
+}
+
+bool Profiler::dumpCsv(const char *path) const {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Could not write profile to %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "frame,timeline,name,depth,start_ms,duration_ms\n");
+    for (int f = 0; f < HISTORY_FRAMES; f++) {
+        const Frame &frame = frames[f];
+        if (frame.number < 0) continue;
+        for (int i = 0; i < frame.cpuCount; i++) {
+            const Event &event = cpuEvents[f * MAX_SCOPES + i];
+            fprintf(file, "%lld,cpu,%s,%d,%.4f,%.4f\n", frame.number, event.name, event.depth,
+                    event.start * 1000.0, (event.end - event.start) * 1000.0);
+        }
+        if (!frame.gpuResolved) continue;
+        for (int i = 0; i < frame.gpuCount; i++) {
+            const Event &event = gpuEvents[f * MAX_GPU_SCOPES + i];
+            fprintf(file, "%lld,gpu,%s,%d,%.4f,%.4f\n", frame.number, event.name, event.depth,
+                    event.start * 1000.0, (event.end - event.start) * 1000.0);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// chrome://tracing or https://ui.perfetto.dev can open this
+bool Profiler::dumpChromeTrace(const char *path) const {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Could not write profile to %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}");
+    for (int f = 0; f < HISTORY_FRAMES; f++) {
+        const Frame &frame = frames[f];
+        if (frame.number < 0) continue;
+        for (int i = 0; i < frame.cpuCount; i++) {
+            const Event &event = cpuEvents[f * MAX_SCOPES + i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%lld}}",
+                    event.name, event.start * 1e6, (event.end - event.start) * 1e6, frame.number);
+        }
+        if (!frame.gpuResolved) continue;
+        for (int i = 0; i < frame.gpuCount; i++) {
+            const Event &event = gpuEvents[f * MAX_GPU_SCOPES + i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%lld}}",
+                    event.name, event.start * 1e6, (event.end - event.start) * 1e6, frame.number);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
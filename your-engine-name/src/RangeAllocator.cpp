@@ -0,0 +1,210 @@
+#include <RangeAllocator.hpp>
+
+static int lowestBit(unsigned value) {
+    return __builtin_ctz(value);
+}
+
+static int highestBit(unsigned value) {
+    return 31 - __builtin_clz(value);
+}
+
+RangeAllocator::RangeAllocator() {
+    reset(0);
+}
+
+void RangeAllocator::reset(unsigned capacity) {
+    blocks.clear();
+    unusedNodes = INVALID;
+    lastBlock = INVALID;
+    total = 0;
+    allocated = 0;
+    firstLevelMap = 0;
+    for (int fl = 0; fl < FL_COUNT; fl++) {
+        secondLevelMap[fl] = 0;
+        for (int sl = 0; sl < SL_COUNT; sl++) heads[fl][sl] = INVALID;
+    }
+    grow(capacity);
+}
+
+void RangeAllocator::grow(unsigned capacity) {
+    if (capacity <= total) return;
+    unsigned extra = capacity - total;
+
+    if (lastBlock != INVALID && blocks[lastBlock].free) {
+        removeFree(lastBlock);
+        blocks[lastBlock].size += extra;
+        insertFree(lastBlock);
+    } else {
+        unsigned block = newNode();
+        Block &b = blocks[block];
+        b.offset = total;
+        b.size = extra;
+        b.prevPhysical = lastBlock;
+        b.nextPhysical = INVALID;
+        if (lastBlock != INVALID) blocks[lastBlock].nextPhysical = block;
+        lastBlock = block;
+        insertFree(block);
+    }
+    total = capacity;
+}
+
+unsigned RangeAllocator::allocate(unsigned size) {
+    if (size == 0) size = 1;
+    unsigned block = findFree(size);
+    if (block == INVALID) return INVALID;
+    removeFree(block);
+
+    // Split the tail off and give it back
+    if (blocks[block].size > size) {
+        unsigned rest = newNode();
+        Block &b = blocks[block];
+        Block &r = blocks[rest];
+        r.offset = b.offset + size;
+        r.size = b.size - size;
+        r.prevPhysical = block;
+        r.nextPhysical = b.nextPhysical;
+        if (b.nextPhysical != INVALID) blocks[b.nextPhysical].prevPhysical = rest;
+        else lastBlock = rest;
+        b.nextPhysical = rest;
+        b.size = size;
+        insertFree(rest);
+    }
+
+    blocks[block].free = false;
+    allocated += size;
+    return block;
+}
+
+void RangeAllocator::free(unsigned block) {
+    if (block == INVALID || blocks[block].free) return;
+    allocated -= blocks[block].size;
+
+    // Merge with the next block
+    unsigned next = blocks[block].nextPhysical;
+    if (next != INVALID && blocks[next].free) {
+        removeFree(next);
+        blocks[block].size += blocks[next].size;
+        blocks[block].nextPhysical = blocks[next].nextPhysical;
+        if (blocks[next].nextPhysical != INVALID) blocks[blocks[next].nextPhysical].prevPhysical = block;
+        else lastBlock = block;
+        releaseNode(next);
+    }
+
+    // Merge into the previous block
+    unsigned previous = blocks[block].prevPhysical;
+    if (previous != INVALID && blocks[previous].free) {
+        removeFree(previous);
+        blocks[previous].size += blocks[block].size;
+        blocks[previous].nextPhysical = blocks[block].nextPhysical;
+        if (blocks[block].nextPhysical != INVALID) blocks[blocks[block].nextPhysical].prevPhysical = previous;
+        else lastBlock = previous;
+        releaseNode(block);
+        block = previous;
+    }
+
+    insertFree(block);
+}
+
+unsigned RangeAllocator::largestFree() const {
+    if (!firstLevelMap) return 0;
+    int fl = highestBit(firstLevelMap);
+    int sl = highestBit(secondLevelMap[fl]);
+    // Blocks in one class differ in size, walk the (short) list of the biggest class
+    unsigned largest = 0;
+    for (unsigned block = heads[fl][sl]; block != INVALID; block = blocks[block].nextFree) {
+        if (blocks[block].size > largest) largest = blocks[block].size;
+    }
+    return largest;
+}
+
+unsigned RangeAllocator::newNode() {
+    unsigned node;
+    if (unusedNodes != INVALID) {
+        node = unusedNodes;
+        unusedNodes = blocks[node].nextFree;
+    } else {
+        node = (unsigned)blocks.size();
+        blocks.push_back(Block());
+    }
+    Block &b = blocks[node];
+    b.offset = b.size = 0;
+    b.prevPhysical = b.nextPhysical = b.prevFree = b.nextFree = INVALID;
+    b.free = false;
+    return node;
+}
+
+void RangeAllocator::releaseNode(unsigned node) {
+    blocks[node].free = false;
+    blocks[node].nextFree = unusedNodes;
+    unusedNodes = node;
+}
+
+// Sizes below SL_COUNT map linearly into class 0, above that 16 classes per power of two
+void RangeAllocator::mapping(unsigned size, int &fl, int &sl) {
+    if (size < SL_COUNT) {
+        fl = 0;
+        sl = (int)size;
+    } else {
+        int msb = highestBit(size);
+        fl = msb - SL_LOG2 + 1;
+        sl = (int)(size >> (msb - SL_LOG2)) - SL_COUNT;
+    }
+}
+
+void RangeAllocator::insertFree(unsigned block) {
+    int fl, sl;
+    mapping(blocks[block].size, fl, sl);
+    Block &b = blocks[block];
+    b.free = true;
+    b.prevFree = INVALID;
+    b.nextFree = heads[fl][sl];
+    if (heads[fl][sl] != INVALID) blocks[heads[fl][sl]].prevFree = block;
+    heads[fl][sl] = block;
+    firstLevelMap |= 1u << fl;
+    secondLevelMap[fl] |= 1u << sl;
+}
+
+void RangeAllocator::removeFree(unsigned block) {
+    int fl, sl;
+    mapping(blocks[block].size, fl, sl);
+    Block &b = blocks[block];
+    if (b.prevFree != INVALID) blocks[b.prevFree].nextFree = b.nextFree;
+    else heads[fl][sl] = b.nextFree;
+    if (b.nextFree != INVALID) blocks[b.nextFree].prevFree = b.prevFree;
+    b.free = false;
+
+    if (heads[fl][sl] == INVALID) {
+        secondLevelMap[fl] &= ~(1u << sl);
+        if (!secondLevelMap[fl]) firstLevelMap &= ~(1u << fl);
+    }
+}
+
+unsigned RangeAllocator::findFree(unsigned size) {
+    // Round up to the next class so every block in the class found is big enough
+    unsigned rounded = size;
+    if (size >= SL_COUNT) {
+        unsigned step = (1u << (highestBit(size) - SL_LOG2)) - 1;
+        if (size > 0xFFFFFFFFu - step) return INVALID;
+        rounded = size + step;
+    }
+    int fl, sl;
+    mapping(rounded, fl, sl);
+
+    unsigned slMap = secondLevelMap[fl] & (~0u << sl);
+    if (!slMap) {
+        unsigned flMap = fl + 1 < 32 ? firstLevelMap & (~0u << (fl + 1)) : 0;
+        if (!flMap) {
+            // Nothing in a guaranteed class, the exact class may still hold a block that fits
+            int exactFl, exactSl;
+            mapping(size, exactFl, exactSl);
+            for (unsigned block = heads[exactFl][exactSl]; block != INVALID; block = blocks[block].nextFree) {
+                if (blocks[block].size >= size) return block;
+            }
+            return INVALID;
+        }
+        fl = lowestBit(flMap);
+        slMap = secondLevelMap[fl];
+    }
+    sl = lowestBit(slMap);
+    return heads[fl][sl];
+}
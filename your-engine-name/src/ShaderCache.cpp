@@ -0,0 +1,114 @@
+#include <ShaderCache.hpp>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <sys/stat.h>
+
+static const unsigned int CACHE_MAGIC = 0x42504c47;  // "GLPB"
+static const unsigned int CACHE_VERSION = 1;
+
+struct CacheHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long key;
+    GLenum format;
+    GLint length;
+};
+
+// FNV-1a, plenty for telling shader sources apart
+static unsigned long long hashBytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+ShaderCache::ShaderCache() {
+    directory = "shader-cache";
+    enabled = true;
+    hits = 0;
+    misses = 0;
+}
+
+unsigned long long ShaderCache::key(const ShaderStage *stages, int count) {
+    // Driver strings need a context, grab them on first use
+    if (driver.empty()) {
+        const GLubyte *vendor = glGetString(GL_VENDOR);
+        const GLubyte *renderer = glGetString(GL_RENDERER);
+        const GLubyte *version = glGetString(GL_VERSION);
+        driver = std::string(vendor ? (const char *)vendor : "") + "|" +
+                 (renderer ? (const char *)renderer : "") + "|" +
+                 (version ? (const char *)version : "");
+    }
+
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = hashBytes(hash, driver.c_str(), driver.size());
+    for (int i = 0; i < count; i++) {
+        hash = hashBytes(hash, &stages[i].type, sizeof(stages[i].type));
+        hash = hashBytes(hash, stages[i].source, strlen(stages[i].source) + 1);
+    }
+    return hash;
+}
+
+std::string ShaderCache::path(unsigned long long key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", key);
+    return directory + name;
+}
+
+bool ShaderCache::load(GLuint program, unsigned long long key) {
+    if (!enabled) return false;
+
+    FILE *file = fopen(path(key).c_str(), "rb");
+    if (!file) return false;
+
+    CacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == CACHE_MAGIC &&
+                 header.version == CACHE_VERSION &&
+                 header.key == key &&
+                 header.length > 0;
+
+    std::vector<char> binary;
+    if (valid) {
+        binary.resize(header.length);
+        valid = fread(&binary[0], 1, header.length, file) == (size_t)header.length;
+    }
+    fclose(file);
+    if (!valid) return false;
+
+    // Driver may still refuse it (e.g. same version string, different build)
+    glProgramBinary(program, header.format, &binary[0], header.length);
+    GLint isLinked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    return isLinked == GL_TRUE;
+}
+
+void ShaderCache::store(GLuint program, unsigned long long key) {
+    if (!enabled) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    CacheHeader header;
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.length = length;
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, &header.length, &header.format, &binary[0]);
+    if (header.length <= 0) return;
+
+    mkdir(directory.c_str(), 0755);
+    FILE *file = fopen(path(key).c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Could not write shader cache entry %s\n", path(key).c_str());
+        return;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(&binary[0], 1, header.length, file);
+    fclose(file);
+}
@@ -0,0 +1,189 @@
+#include <ShaderPreprocessor.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+static const int MAX_INCLUDE_DEPTH = 32;
+
+static std::string directoryOf(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// Resolves "a/../b.glsl" and symlinks so #pragma once recognises a file however it's reached
+static bool canonicalPath(const std::string &path, std::string &canonical) {
+    char resolved[PATH_MAX];
+    if (!realpath(path.c_str(), resolved)) return false;
+    canonical = resolved;
+    return true;
+}
+
+// Directive name after '#' ("include", "version", ...), empty when the line is no directive
+static std::string directive(const std::string &line, size_t &rest) {
+    size_t i = line.find_first_not_of(" \t");
+    if (i == std::string::npos || line[i] != '#') return "";
+    i = line.find_first_not_of(" \t", i + 1);
+    if (i == std::string::npos) return "";
+    size_t end = line.find_first_of(" \t\r", i);
+    if (end == std::string::npos) end = line.size();
+    rest = end;
+    return line.substr(i, end - i);
+}
+
+std::string ShaderPreprocessor::key(const ShaderDefines &defines) {
+    std::vector<std::string> parts;
+    for (size_t i = 0; i < defines.size(); i++) {
+        parts.push_back(defines[i].name + (defines[i].value.empty() ? "" : "=" + defines[i].value));
+    }
+    std::sort(parts.begin(), parts.end());
+
+    std::string result;
+    for (size_t i = 0; i < parts.size(); i++) result += parts[i] + ";";
+    return result;
+}
+
+bool ShaderPreprocessor::process(const std::string &path, const ShaderDefines &defines, std::string &output) {
+    std::string source;
+    if (!ShaderProgram::readSource(path, source)) return false;
+    return processSource(source, path, defines, output);
+}
+
+bool ShaderPreprocessor::processSource(const std::string &source, const std::string &path,
+                                       const ShaderDefines &defines, std::string &output) {
+    fileNames.clear();
+    onceFiles.clear();
+    output.clear();
+
+    std::string canonical;
+    return expand(source, canonicalPath(path, canonical) ? canonical : path, 0, &defines, output);
+}
+
+bool ShaderPreprocessor::resolve(const std::string &name, const std::string &from, std::string &path) const {
+    if (canonicalPath(directoryOf(from) + name, path)) return true;
+    for (size_t i = 0; i < includePaths.size(); i++) {
+        if (canonicalPath(includePaths[i] + "/" + name, path)) return true;
+    }
+    return false;
+}
+
+bool ShaderPreprocessor::expand(const std::string &source, const std::string &path, int depth,
+                                const ShaderDefines *defines, std::string &output) {
+    if (depth > MAX_INCLUDE_DEPTH) {
+        fprintf(stderr, "%s: includes nested too deep (include cycle?)\n", path.c_str());
+        return false;
+    }
+
+    int fileIndex = (int)fileNames.size();
+    fileNames.push_back(path);
+
+    std::ostringstream defineBlock;
+    if (defines) {
+        for (size_t i = 0; i < defines->size(); i++) {
+            defineBlock << "#define " << (*defines)[i].name << " " << (*defines)[i].value << "\n";
+        }
+    }
+    // Root file without #version gets its defines at the very top, the #line puts its
+    // first line back at 1
+    bool definesPending = defines && !defines->empty();
+    bool prepended = false;
+    if (definesPending && source.find("#version") == std::string::npos) {
+        output += defineBlock.str();
+        definesPending = false;
+        prepended = true;
+    }
+    if (depth > 0 || prepended) output += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+    std::istringstream lines(source);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        size_t rest = 0;
+        std::string name = directive(line, rest);
+
+        if (name == "version") {
+            output += line + "\n";
+            if (definesPending) {
+                output += defineBlock.str();
+                definesPending = false;
+            }
+            output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+        } else if (name == "pragma" && line.find("once", rest) != std::string::npos) {
+            onceFiles.insert(path);
+            output += "\n";
+        } else if (name == "include") {
+            size_t open = line.find_first_of("\"<", rest);
+            size_t close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+            if (close == std::string::npos) {
+                fprintf(stderr, "%s:%d: malformed #include\n", path.c_str(), lineNumber);
+                return false;
+            }
+
+            std::string includePath;
+            std::string includeName = line.substr(open + 1, close - open - 1);
+            if (!resolve(includeName, path, includePath)) {
+                fprintf(stderr, "%s:%d: can't find include %s\n", path.c_str(), lineNumber, includeName.c_str());
+                return false;
+            }
+            if (onceFiles.count(includePath)) {
+                output += "\n";
+                continue;
+            }
+
+            std::string included;
+            if (!ShaderProgram::readSource(includePath, included)) return false;
+            if (!expand(included, includePath, depth + 1, NULL, output)) return false;
+            output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+        } else {
+            output += line + "\n";
+        }
+    }
+    return true;
+}
+
+ShaderVariants::ShaderVariants() {
+    preprocessor = NULL;
+    cache = NULL;
+}
+
+void ShaderVariants::setup(const ShaderFile *files, int count, ShaderPreprocessor *preprocessor, ShaderCache *cache) {
+    destroy();
+    stages.assign(files, files + count);
+    paths.clear();
+    for (int i = 0; i < count; i++) paths.push_back(files[i].path);
+    for (int i = 0; i < count; i++) stages[i].path = paths[i].c_str();
+    this->preprocessor = preprocessor;
+    this->cache = cache;
+}
+
+void ShaderVariants::destroy() {
+    for (std::map<std::string, ShaderProgram>::iterator it = variants.begin(); it != variants.end(); ++it) {
+        it->second.destroy();
+    }
+    variants.clear();
+}
+
+ShaderProgram *ShaderVariants::get(const ShaderDefines &defines) {
+    std::string variantKey = ShaderPreprocessor::key(defines);
+    std::map<std::string, ShaderProgram>::iterator found = variants.find(variantKey);
+    if (found != variants.end()) {
+        return found->second.status() == ShaderProgram::READY ? &found->second : NULL;
+    }
+
+    // First time this permutation is used, build it now
+    ShaderProgram &program = variants[variantKey];
+    std::vector<std::string> sources(stages.size());
+    std::vector<ShaderStage> expanded(stages.size());
+    for (size_t i = 0; i < stages.size(); i++) {
+        if (!preprocessor->process(stages[i].path, defines, sources[i])) return NULL;
+        expanded[i].type = stages[i].type;
+        expanded[i].source = sources[i].c_str();
+    }
+    if (!program.build(&expanded[0], (int)expanded.size(), cache)) {
+        fprintf(stderr, "Shader variant [%s] failed to build\n", variantKey.c_str());
+        return NULL;
+    }
+    return &program;
+}
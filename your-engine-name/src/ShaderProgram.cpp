@@ -0,0 +1,293 @@
+#include <ShaderProgram.hpp>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <GLFW/glfw3.h>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+ShaderProgram::ShaderProgram() {
+    program = 0;
+    state = EMPTY;
+    pendingCache = NULL;
+    pendingKey = 0;
+}
+
+static bool parallelCompile = false;
+
+bool ShaderProgram::enableParallelCompile() {
+    parallelCompile = glfwExtensionSupported("GL_KHR_parallel_shader_compile") ||
+                      glfwExtensionSupported("GL_ARB_parallel_shader_compile");
+    if (parallelCompile) {
+        // Let the driver pick as many compiler threads as it likes
+        typedef void (*MaxShaderCompilerThreadsFunction)(GLuint count);
+        MaxShaderCompilerThreadsFunction maxShaderCompilerThreads =
+            (MaxShaderCompilerThreadsFunction)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (!maxShaderCompilerThreads) {
+            maxShaderCompilerThreads = (MaxShaderCompilerThreadsFunction)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+        }
+        if (maxShaderCompilerThreads) maxShaderCompilerThreads(0xFFFFFFFF);
+    }
+    return parallelCompile;
+}
+
+// Prints the info log of a failed shader
+static bool isShaderCompiled(GLuint shader) {
+    GLint isCompiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+    if (isCompiled == GL_FALSE) {
+        // The maxLength includes the "NULL" character
+        GLint maxLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+        std::vector<GLchar> errorLog(maxLength + 1);
+        glGetShaderInfoLog(shader, maxLength, &maxLength, &errorLog[0]);
+        fprintf(stderr, "Shader compilation failed:\n%s\n", &errorLog[0]);
+        return false;
+    }
+    return true;
+}
+
+GLuint ShaderProgram::compileStage(const ShaderStage &stage) {
+    GLuint shader = glCreateShader(stage.type);
+    glShaderSource(shader, 1, &stage.source, 0);
+    glCompileShader(shader);
+
+    if (!isShaderCompiled(shader)) {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool ShaderProgram::readSource(const std::string &path, std::string &source) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "Could not open shader %s\n", path.c_str());
+        return false;
+    }
+    source.clear();
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) source.append(buffer, length);
+    fclose(file);
+    return true;
+}
+
+bool ShaderProgram::build(const ShaderStage *stages, int count, ShaderCache *cache) {
+    submit(stages, count, cache);
+    return wait();
+}
+
+void ShaderProgram::submit(const ShaderStage *stages, int count, ShaderCache *cache) {
+    destroy();
+
+    // No binary formats -> nothing we could ever load back
+    GLint formats = 0;
+    if (cache && cache->enabled) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    pendingCache = formats > 0 ? cache : NULL;
+
+    if (pendingCache) {
+        pendingKey = pendingCache->key(stages, count);
+        program = glCreateProgram();
+        if (pendingCache->load(program, pendingKey)) {
+            pendingCache->hits++;
+            pendingCache = NULL;
+            reflect();
+            state = READY;
+            return;
+        }
+        pendingCache->misses++;
+        glDeleteProgram(program);
+        GLState::programDeleted(program);
+    }
+
+    // Kick off every compile and the link without asking for any status,
+    // asking is what makes the driver finish the work on this thread
+    program = glCreateProgram();
+    for (int i = 0; i < count; i++) {
+        GLuint shader = glCreateShader(stages[i].type);
+        glShaderSource(shader, 1, &stages[i].source, 0);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        pendingShaders.push_back(shader);
+    }
+    if (pendingCache) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    state = PENDING;
+}
+
+bool ShaderProgram::poll() {
+    if (state != PENDING) return true;
+    if (parallelCompile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+        if (completed == GL_FALSE) return false;
+    }
+    finish();
+    return true;
+}
+
+bool ShaderProgram::wait() {
+    if (state == PENDING) finish();
+    return state == READY;
+}
+
+void ShaderProgram::finish() {
+    bool compiled = true;
+    for (size_t i = 0; i < pendingShaders.size(); i++) {
+        if (!isShaderCompiled(pendingShaders[i])) compiled = false;
+    }
+
+    GLint isLinked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    if (compiled && isLinked == GL_FALSE) {
+        GLint maxLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+        std::vector<GLchar> errorLog(maxLength + 1);
+        glGetProgramInfoLog(program, maxLength, &maxLength, &errorLog[0]);
+        fprintf(stderr, "Program linking failed:\n%s\n", &errorLog[0]);
+    }
+
+    // Delete the shaders as the program has them now
+    for (size_t i = 0; i < pendingShaders.size(); i++) glDeleteShader(pendingShaders[i]);
+    pendingShaders.clear();
+
+    if (!compiled || isLinked == GL_FALSE) {
+        destroy();
+        state = FAILED;
+        return;
+    }
+
+    if (pendingCache) pendingCache->store(program, pendingKey);
+    pendingCache = NULL;
+    reflect();
+    state = READY;
+}
+
+void ShaderProgram::swap(ShaderProgram &other) {
+    std::swap(program, other.program);
+    std::swap(state, other.state);
+    std::swap(pendingShaders, other.pendingShaders);
+    std::swap(pendingCache, other.pendingCache);
+    std::swap(pendingKey, other.pendingKey);
+    std::swap(table, other.table);
+}
+
+void ShaderProgram::destroy() {
+    for (size_t i = 0; i < pendingShaders.size(); i++) glDeleteShader(pendingShaders[i]);
+    pendingShaders.clear();
+    pendingCache = NULL;
+
+    if (program) {
+        glDeleteProgram(program);
+        GLState::programDeleted(program);
+    }
+    program = 0;
+    state = EMPTY;
+    table.clear();
+}
+
+// FNV-1a, never returns 0 (empty slot marker)
+unsigned int ShaderProgram::hashName(const char *name, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+ShaderProgram::Entry &ShaderProgram::insert(const char *name, size_t length) {
+    unsigned int hash = hashName(name, length);
+    size_t mask = table.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        Entry &entry = table[i];
+        if (entry.hash == 0) {
+            entry.hash = hash;
+            entry.name.assign(name, length);
+            return entry;
+        }
+        if (entry.hash == hash && entry.name.compare(0, std::string::npos, name, length) == 0) {
+            return entry;
+        }
+    }
+}
+
+const ShaderProgram::Entry *ShaderProgram::find(const char *name) const {
+    if (table.empty()) return NULL;
+    size_t length = strlen(name);
+    unsigned int hash = hashName(name, length);
+    size_t mask = table.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const Entry &entry = table[i];
+        if (entry.hash == 0) return NULL;
+        if (entry.hash == hash && entry.name == name) return &entry;
+    }
+}
+
+void ShaderProgram::reflect() {
+    GLint uniformCount = 0;
+    GLint blockCount = 0;
+    GLint maxUniformLength = 0;
+    GLint maxBlockLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformLength);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockLength);
+
+    // Every array element gets its own entry ("lights[2]"), element 0 a second one without "[0]"
+    std::vector<GLchar> name((maxUniformLength > maxBlockLength ? maxUniformLength : maxBlockLength) + 1);
+    std::vector<std::pair<std::string, GLint> > uniforms;
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLsizei length = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, i, (GLsizei)name.size(), &length, &arraySize, &type, &name[0]);
+
+        // Block members have no location, they're set through the buffer
+        GLint location = glGetUniformLocation(program, &name[0]);
+        if (location < 0) continue;
+
+        uniforms.push_back(std::make_pair(std::string(&name[0], length), location));
+        if (length > 3 && strcmp(&name[length - 3], "[0]") == 0) {
+            std::string base(&name[0], length - 3);
+            uniforms.push_back(std::make_pair(base, location));
+            // Element locations aren't guaranteed to be consecutive, ask for each one
+            for (GLint element = 1; element < arraySize; element++) {
+                char index[16];
+                snprintf(index, sizeof(index), "[%d]", element);
+                std::string elementName = base + index;
+                GLint elementLocation = glGetUniformLocation(program, elementName.c_str());
+                if (elementLocation >= 0) uniforms.push_back(std::make_pair(elementName, elementLocation));
+            }
+        }
+    }
+
+    // Keep the load factor under 1/2
+    size_t size = 16;
+    while (size < (uniforms.size() + blockCount) * 2) size *= 2;
+    table.assign(size, Entry());
+
+    for (size_t i = 0; i < uniforms.size(); i++) {
+        insert(uniforms[i].first.c_str(), uniforms[i].first.size()).location = uniforms[i].second;
+    }
+
+    for (GLint i = 0; i < blockCount; i++) {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(program, i, (GLsizei)name.size(), &length, &name[0]);
+        insert(&name[0], length).block = (GLuint)i;
+    }
+}
+
+GLint ShaderProgram::uniform(const char *name) const {
+    const Entry *entry = find(name);
+    return entry ? entry->location : -1;
+}
+
+GLuint ShaderProgram::uniformBlock(const char *name) const {
+    const Entry *entry = find(name);
+    return entry ? entry->block : GL_INVALID_INDEX;
+}
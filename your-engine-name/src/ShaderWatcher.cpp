@@ -0,0 +1,121 @@
+#include <ShaderWatcher.hpp>
+#include <chrono>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// "shaders/basic.vs" -> "shaders/", "basic.vs" -> ""
+static std::string directoryOf(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+static long long modificationTime(const std::string &path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return -1;
+    return (long long)info.st_mtime;
+}
+
+ShaderWatcher::ShaderWatcher() {
+    running = false;
+#ifdef __linux__
+    inotifyFd = -1;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    stop();
+}
+
+void ShaderWatcher::start() {
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    running = true;
+    thread = std::thread(&ShaderWatcher::watchLoop, this);
+}
+
+void ShaderWatcher::stop() {
+    if (!running) return;
+    running = false;
+    thread.join();
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+    inotifyFd = -1;
+    directories.clear();
+#endif
+}
+
+void ShaderWatcher::watch(const std::string &path) {
+    if (!running) start();
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (!files.insert(path).second) return;
+
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        std::string directory = directoryOf(path);
+        int wd = inotify_add_watch(inotifyFd, directory.empty() ? "." : directory.c_str(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd >= 0) directories[wd] = directory;
+    }
+#endif
+}
+
+bool ShaderWatcher::takeChanged(std::vector<std::string> &changed) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (changedFiles.empty()) return false;
+    changed.insert(changed.end(), changedFiles.begin(), changedFiles.end());
+    changedFiles.clear();
+    return true;
+}
+
+void ShaderWatcher::watchLoop() {
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        while (running) {
+            // Wake up now and then to notice stop()
+            struct pollfd descriptor = { inotifyFd, POLLIN, 0 };
+            if (poll(&descriptor, 1, 100) <= 0) continue;
+
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            std::lock_guard<std::mutex> guard(lock);
+            for (ssize_t offset = 0; offset < length; ) {
+                const struct inotify_event *event = (const struct inotify_event *)(buffer + offset);
+                offset += sizeof(struct inotify_event) + event->len;
+                if (!event->len || !directories.count(event->wd)) continue;
+
+                std::string path = directories[event->wd] + event->name;
+                if (files.count(path)) changedFiles.insert(path);
+            }
+        }
+        return;
+    }
+#endif
+
+    // No inotify, compare modification times a few times per second
+    while (running) {
+        std::vector<std::string> snapshot;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            snapshot.assign(files.begin(), files.end());
+        }
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            long long mtime = modificationTime(snapshot[i]);
+            std::map<std::string, long long>::iterator known = mtimes.find(snapshot[i]);
+            if (known == mtimes.end()) {
+                mtimes[snapshot[i]] = mtime;
+            } else if (known->second != mtime) {
+                known->second = mtime;
+                std::lock_guard<std::mutex> guard(lock);
+                changedFiles.insert(snapshot[i]);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+}
@@ -0,0 +1,141 @@
+#include <StreamBuffer.hpp>
+#include <GLState.hpp>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// GL_ARB_buffer_storage, not in the 4.1 headers
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (*BufferStorageFunction)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+static BufferStorageFunction bufferStorage() {
+    if (!glfwExtensionSupported("GL_ARB_buffer_storage")) return NULL;
+    BufferStorageFunction function = (BufferStorageFunction)glfwGetProcAddress("glBufferStorage");
+    if (!function) function = (BufferStorageFunction)glfwGetProcAddress("glBufferStorageARB");
+    return function;
+}
+
+StreamBuffer::StreamBuffer() {
+    stalls = 0;
+    overflows = 0;
+    buffer = 0;
+    bufferTarget = GL_ARRAY_BUFFER;
+    regionSize = 0;
+    regionCount = 0;
+    region = 0;
+    head = 0;
+    flushed = 0;
+    for (int i = 0; i < MAX_FRAMES; i++) fences[i] = 0;
+    mapped = NULL;
+    staging = NULL;
+}
+
+StreamBuffer::~StreamBuffer() {
+    destroy();
+}
+
+bool StreamBuffer::create(GLenum target, GLsizeiptr frameSize, int frames) {
+    destroy();
+    if (frames < 2) frames = 2;
+    if (frames > MAX_FRAMES) frames = MAX_FRAMES;
+
+    // Keep every region start aligned for uniform block binding
+    GLsizeiptr alignment = uniformAlignment();
+    regionSize = (frameSize + alignment - 1) / alignment * alignment;
+    regionCount = frames;
+    bufferTarget = target;
+    region = 0;
+    head = 0;
+    flushed = 0;
+
+    glGenBuffers(1, &buffer);
+    GLState::bindBuffer(target, buffer);
+
+    BufferStorageFunction storage = bufferStorage();
+    if (storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        storage(target, regionSize * regionCount, NULL, flags);
+        mapped = (unsigned char *)glMapBufferRange(target, 0, regionSize * regionCount, flags);
+    }
+    if (!mapped) {
+        if (storage) fprintf(stderr, "StreamBuffer: persistent mapping failed, using glBufferSubData\n");
+        glBufferData(target, regionSize * regionCount, NULL, GL_STREAM_DRAW);
+        staging = (unsigned char *)malloc(regionSize);
+    }
+    return buffer != 0;
+}
+
+void StreamBuffer::destroy() {
+    if (!buffer) return;
+    for (int i = 0; i < MAX_FRAMES; i++) {
+        if (fences[i]) glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+    if (mapped) {
+        GLState::bindBuffer(bufferTarget, buffer);
+        glUnmapBuffer(bufferTarget);
+        mapped = NULL;
+    }
+    free(staging);
+    staging = NULL;
+    glDeleteBuffers(1, &buffer);
+    GLState::bufferDeleted(buffer);
+    buffer = 0;
+}
+
+void StreamBuffer::beginFrame() {
+    head = 0;
+    flushed = 0;
+    GLsync fence = fences[region];
+    if (!fence) return;
+
+    // Only block when the GPU is still reading the region we're about to overwrite
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        stalls++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fences[region] = 0;
+}
+
+StreamAllocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+    StreamAllocation allocation = {NULL, buffer, 0, size};
+    GLsizeiptr start = (head + alignment - 1) & ~(alignment - 1);
+    if (!buffer || start + size > regionSize) {
+        overflows++;
+        return allocation;
+    }
+    head = start + size;
+
+    allocation.offset = region * regionSize + start;
+    allocation.pointer = mapped ? mapped + allocation.offset : staging + start;
+    return allocation;
+}
+
+void StreamBuffer::flush() {
+    if (mapped || head == flushed) return;
+    GLState::bindBuffer(bufferTarget, buffer);
+    glBufferSubData(bufferTarget, region * regionSize + flushed, head - flushed, staging + flushed);
+    flushed = head;
+}
+
+void StreamBuffer::endFrame() {
+    flush();
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region = (region + 1) % regionCount;
+}
+
+GLsizeiptr StreamBuffer::uniformAlignment() {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return alignment > 0 ? alignment : 256;
+}
@@ -0,0 +1,217 @@
+#include <TransformBatch.hpp>
+
+// The AVX2 kernels are compiled with a per-function target attribute, the rest of the engine stays baseline
+#if defined(VMATH_SSE) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_BATCH_AVX2 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  SCALAR                                                          │
+// └──────────────────────────────────────────────────────────────────┘
+static void transformPointsScalar(const vmath::mat4 &m, const float *x, const float *y, const float *z,
+                                  float *outX, float *outY, float *outZ, float *outW, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        float px = x[i], py = y[i], pz = z[i];
+        outX[i] = m[0][0] * px + m[1][0] * py + m[2][0] * pz + m[3][0];
+        outY[i] = m[0][1] * px + m[1][1] * py + m[2][1] * pz + m[3][1];
+        outZ[i] = m[0][2] * px + m[1][2] * py + m[2][2] * pz + m[3][2];
+        if (outW) outW[i] = m[0][3] * px + m[1][3] * py + m[2][3] * pz + m[3][3];
+    }
+}
+
+static void multiplyScalar(const vmath::mat4 &m, const vmath::mat4 *models, vmath::mat4 *out, int count) {
+    for (int i = 0; i < count; i++) {
+        // Through a temporary so out == models works
+        vmath::mat4 result;
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                result[c][r] = m[0][r] * models[i][c][0] + m[1][r] * models[i][c][1] +
+                               m[2][r] * models[i][c][2] + m[3][r] * models[i][c][3];
+            }
+        }
+        out[i] = result;
+    }
+}
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  SSE                                                             │
+// └──────────────────────────────────────────────────────────────────┘
+#ifdef VMATH_SSE
+
+static void transformPointsSse(const vmath::mat4 &m, const float *x, const float *y, const float *z,
+                               float *outX, float *outY, float *outZ, float *outW, int count) {
+    __m128 e[16];
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) e[c * 4 + r] = _mm_set1_ps(m[c][r]);
+    }
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        for (int r = 0; r < 4; r++) {
+            float *target = r == 0 ? outX : r == 1 ? outY : r == 2 ? outZ : outW;
+            if (!target) continue;
+            __m128 sum = _mm_add_ps(_mm_mul_ps(e[r], px), e[12 + r]);
+            sum = _mm_add_ps(sum, _mm_mul_ps(e[4 + r], py));
+            sum = _mm_add_ps(sum, _mm_mul_ps(e[8 + r], pz));
+            _mm_storeu_ps(target + i, sum);
+        }
+    }
+    transformPointsScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+static void multiplySse(const vmath::mat4 &m, const vmath::mat4 *models, vmath::mat4 *out, int count) {
+    const float *pm = m.data();
+    __m128 m0 = _mm_loadu_ps(pm);
+    __m128 m1 = _mm_loadu_ps(pm + 4);
+    __m128 m2 = _mm_loadu_ps(pm + 8);
+    __m128 m3 = _mm_loadu_ps(pm + 12);
+
+    for (int i = 0; i < count; i++) {
+        const float *model = models[i].data();
+        __m128 columns[4];
+        for (int c = 0; c < 4; c++) {
+            __m128 v = _mm_loadu_ps(model + c * 4);
+            __m128 sum = _mm_mul_ps(m0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(m1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(m2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(m3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+            columns[c] = sum;
+        }
+        float *result = out[i].data();
+        for (int c = 0; c < 4; c++) _mm_storeu_ps(result + c * 4, columns[c]);
+    }
+}
+
+#endif /* VMATH_SSE */
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  AVX2 + FMA                                                      │
+// └──────────────────────────────────────────────────────────────────┘
+#ifdef TRANSFORM_BATCH_AVX2
+
+AVX2_TARGET
+static void transformPointsAvx2(const vmath::mat4 &m, const float *x, const float *y, const float *z,
+                                float *outX, float *outY, float *outZ, float *outW, int count) {
+    __m256 e[16];
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) e[c * 4 + r] = _mm256_set1_ps(m[c][r]);
+    }
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 pz = _mm256_loadu_ps(z + i);
+        for (int r = 0; r < 4; r++) {
+            float *target = r == 0 ? outX : r == 1 ? outY : r == 2 ? outZ : outW;
+            if (!target) continue;
+            __m256 sum = _mm256_fmadd_ps(e[r], px, e[12 + r]);
+            sum = _mm256_fmadd_ps(e[4 + r], py, sum);
+            sum = _mm256_fmadd_ps(e[8 + r], pz, sum);
+            _mm256_storeu_ps(target + i, sum);
+        }
+    }
+    transformPointsScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+// Two result columns per register, m's columns broadcast to both halves once for the whole batch
+AVX2_TARGET
+static void multiplyAvx2(const vmath::mat4 &m, const vmath::mat4 *models, vmath::mat4 *out, int count) {
+    const float *pm = m.data();
+    __m256 m0 = _mm256_broadcast_ps((const __m128 *)(pm));
+    __m256 m1 = _mm256_broadcast_ps((const __m128 *)(pm + 4));
+    __m256 m2 = _mm256_broadcast_ps((const __m128 *)(pm + 8));
+    __m256 m3 = _mm256_broadcast_ps((const __m128 *)(pm + 12));
+
+    for (int i = 0; i < count; i++) {
+        const float *model = models[i].data();
+        __m256 low = _mm256_loadu_ps(model);
+        __m256 high = _mm256_loadu_ps(model + 8);
+
+        __m256 sumLow = _mm256_mul_ps(m0, _mm256_permute_ps(low, _MM_SHUFFLE(0, 0, 0, 0)));
+        __m256 sumHigh = _mm256_mul_ps(m0, _mm256_permute_ps(high, _MM_SHUFFLE(0, 0, 0, 0)));
+        sumLow = _mm256_fmadd_ps(m1, _mm256_permute_ps(low, _MM_SHUFFLE(1, 1, 1, 1)), sumLow);
+        sumHigh = _mm256_fmadd_ps(m1, _mm256_permute_ps(high, _MM_SHUFFLE(1, 1, 1, 1)), sumHigh);
+        sumLow = _mm256_fmadd_ps(m2, _mm256_permute_ps(low, _MM_SHUFFLE(2, 2, 2, 2)), sumLow);
+        sumHigh = _mm256_fmadd_ps(m2, _mm256_permute_ps(high, _MM_SHUFFLE(2, 2, 2, 2)), sumHigh);
+        sumLow = _mm256_fmadd_ps(m3, _mm256_permute_ps(low, _MM_SHUFFLE(3, 3, 3, 3)), sumLow);
+        sumHigh = _mm256_fmadd_ps(m3, _mm256_permute_ps(high, _MM_SHUFFLE(3, 3, 3, 3)), sumHigh);
+
+        float *result = out[i].data();
+        _mm256_storeu_ps(result, sumLow);
+        _mm256_storeu_ps(result + 8, sumHigh);
+    }
+}
+
+#endif /* TRANSFORM_BATCH_AVX2 */
+
+// ┌──────────────────────────────────────────────────────────────────┐
+// │  DISPATCH                                                        │
+// └──────────────────────────────────────────────────────────────────┘
+static TransformBatch::Path detectPath() {
+#ifdef TRANSFORM_BATCH_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return TransformBatch::AVX2;
+#endif
+#ifdef VMATH_SSE
+    return TransformBatch::SSE;
+#else
+    return TransformBatch::SCALAR;
+#endif
+}
+
+static TransformBatch::Path &activePath() {
+    static TransformBatch::Path path = TransformBatch::best();
+    return path;
+}
+
+TransformBatch::Path TransformBatch::best() {
+    static Path detected = detectPath();
+    return detected;
+}
+
+TransformBatch::Path TransformBatch::path() {
+    return activePath();
+}
+
+void TransformBatch::setPath(Path path) {
+    activePath() = path > best() ? best() : path;
+}
+
+const char *TransformBatch::name(Path path) {
+    switch (path) {
+        case AVX2: return "AVX2+FMA";
+        case SSE: return "SSE";
+        default: return "scalar";
+    }
+}
+
+void TransformBatch::transformPoints(const vmath::mat4 &m, const float *x, const float *y, const float *z,
+                                     float *outX, float *outY, float *outZ, float *outW, int count) {
+    switch (activePath()) {
+#ifdef TRANSFORM_BATCH_AVX2
+        case AVX2: transformPointsAvx2(m, x, y, z, outX, outY, outZ, outW, count); return;
+#endif
+#ifdef VMATH_SSE
+        case SSE: transformPointsSse(m, x, y, z, outX, outY, outZ, outW, count); return;
+#endif
+        default: transformPointsScalar(m, x, y, z, outX, outY, outZ, outW, 0, count); return;
+    }
+}
+
+void TransformBatch::multiply(const vmath::mat4 &m, const vmath::mat4 *models, vmath::mat4 *out, int count) {
+    switch (activePath()) {
+#ifdef TRANSFORM_BATCH_AVX2
+        case AVX2: multiplyAvx2(m, models, out, count); return;
+#endif
+#ifdef VMATH_SSE
+        case SSE: multiplySse(m, models, out, count); return;
+#endif
+        default: multiplyScalar(m, models, out, count); return;
+    }
+}